@@ -74,4 +74,13 @@ u32 cpu_flags()
         : "memory");
     return flags;
 }
+
+u64 read_timestamp_counter()
+{
+    u32 low;
+    u32 high;
+    asm volatile("rdtsc"
+                 : "=a"(low), "=d"(high));
+    return ((u64)high << 32) | low;
+}
 }
@@ -60,6 +60,7 @@ void set_es_register(const SegmentSelector& selector);
 void set_fs_register(const SegmentSelector& selector);
 void set_gs_register(const SegmentSelector& selector);
 u32 cpu_flags();
+u64 read_timestamp_counter();
 
 class InterruptDisabler {
 public:
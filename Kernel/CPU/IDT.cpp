@@ -14,7 +14,7 @@ static ExceptionHandler s_exception_handlers[EXCEPTION_HANDLER_COUNT];
 
 static IDTPointer s_idt_pointer;
 
-static void divide_by_zero_exception_handler(const InterruptRegisters&)
+static void divide_by_zero_exception_handler(InterruptRegisters&)
 {
     panic("Divide by zero detected!\n");
 }
@@ -40,6 +40,7 @@ extern "C" void isr_handler(InterruptRegisters* regs)
     if (number_between_inclusive(regs->interrupt_number, 0, 31)) {
         if (s_exception_handlers[regs->interrupt_number] != nullptr) {
             s_exception_handlers[regs->interrupt_number](*regs);
+            return;
         }
 
         dbgprintf("IDT", "Interrupt fired: %d\n", regs->interrupt_number);
@@ -59,7 +59,8 @@ struct InterruptRegisters {
     InterruptFrame frame;
 };
 
-typedef void (*ExceptionHandler)(const InterruptRegisters&);
+// Handlers may change the registers that are restored when the exception returns
+typedef void (*ExceptionHandler)(InterruptRegisters&);
 
 namespace IDT {
 
@@ -11,18 +11,19 @@
 
 class PartitionDevice : public BlockDevice {
 public:
-    static UniquePtr<PartitionDevice> create(UniquePtr<BlockDevice> parent_device, size_t offset)
+    // The parent device is shared by every partition on it and has to outlive them
+    static UniquePtr<PartitionDevice> create(BlockDevice& parent_device, size_t offset)
     {
-        return make_unique_ptr<PartitionDevice>(move(parent_device), offset);
+        return make_unique_ptr<PartitionDevice>(parent_device, offset);
     }
 
-    PartitionDevice(UniquePtr<BlockDevice> parent_device, size_t offset);
+    PartitionDevice(BlockDevice& parent_device, size_t offset);
 
     Result read_blocks(u32 block, u32 count, u8* buffer) override;
     Result write_blocks(u32 block, u32 count, const u8* buffer) override;
     size_t block_size() const override;
 
 private:
-    UniquePtr<BlockDevice> m_parent_device;
+    BlockDevice& m_parent_device;
     size_t m_offset;
 };
@@ -29,6 +29,9 @@ public:
 
     size_t length() const override;
 
+    Inode& inode() { return *m_inode; }
+    const Inode& inode() const { return *m_inode; }
+
 private:
     InodeFile(SharedPtr<Inode>&& inode)
         : m_inode(move(inode))
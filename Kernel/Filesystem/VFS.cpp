@@ -14,6 +14,7 @@
 #include <Kernel/Filesystem/InodeFile.h>
 #include <Kernel/Filesystem/InodeId.h>
 #include <Kernel/Filesystem/VFS.h>
+#include <Kernel/Memory/MemoryManager.h>
 #include <Kernel/POSIX.h>
 #include <LibC/errno_defines.h>
 #include <Universal/Logger.h>
@@ -39,7 +40,8 @@ void VFS::init()
     disk->read_blocks(0, 1, master_boot_record);
     u32 partition_offset = *((u32*)&master_boot_record[0x1C6]);
 
-    auto partition_device = PartitionDevice::create(disk.leak_ptr(), partition_offset);
+    m_disk = move(disk);
+    auto partition_device = PartitionDevice::create(*m_disk, partition_offset);
 
     m_root_filesystem = make_unique_ptr<Ext2Filesystem>(partition_device.leak_ptr());
     if (m_root_filesystem.ptr() == nullptr) {
@@ -61,6 +63,22 @@ void VFS::init()
 
     m_random_device = make_unique_ptr<RandomDevice>();
 
+    // The first Linux swap partition in the partition table becomes swap space
+    for (u32 i = 0; i < 4; i++) {
+        u8* partition_entry = &master_boot_record[0x1BE + i * 16];
+        if (partition_entry[4] != 0x82) {
+            continue;
+        }
+
+        u32 swap_offset = *((u32*)&partition_entry[8]);
+        u32 swap_block_count = *((u32*)&partition_entry[12]);
+        auto swap_space = SwapSpace::create(PartitionDevice::create(*m_disk, swap_offset), swap_block_count);
+        if (swap_space.ptr() != nullptr) {
+            MM.enable_swap(move(swap_space));
+        }
+        break;
+    }
+
     dbgprintf("VFS", "VFS initialized\n");
 }
 
@@ -12,6 +12,7 @@
 #include <Universal/SharedPtr.h>
 #include <Universal/UniquePtr.h>
 
+class BlockDevice;
 class DirectoryEntry;
 class Filesystem;
 class FileDescriptor;
@@ -40,6 +41,8 @@ private:
 
     UniquePtr<RandomDevice> m_random_device;
 
+    UniquePtr<BlockDevice> m_disk;
+
     UniquePtr<Filesystem> m_root_filesystem;
     SharedPtr<Inode> m_root_inode;
 };
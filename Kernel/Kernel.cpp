@@ -15,6 +15,7 @@
 #include <Kernel/Devices/VirtualConsole.h>
 #include <Kernel/Filesystem/VFS.h>
 #include <Kernel/Memory/MemoryManager.h>
+#include <Kernel/Memory/PageMerger.h>
 #include <Kernel/Network/NetworkDaemon.h>
 #include <Kernel/Process/ProcessManager.h>
 #include <Universal/Logger.h>
@@ -27,6 +28,8 @@
 #    error "Compiling with incorrect toolchain."
 #endif
 
+#define BENCHMARK_CONTEXT_SWITCH 0
+
 VirtualConsole* tty0;
 
 [[noreturn]] void simple_process_runnable1()
@@ -42,8 +45,82 @@ VirtualConsole* tty0;
     while (true) { }
 }
 
+#if BENCHMARK_CONTEXT_SWITCH
+static constexpr size_t kBenchmarkRoundTrips = 10000;
+static constexpr size_t kBenchmarkTouchedPages = 32;
+
+static volatile bool s_benchmark_running = false;
+static volatile bool s_benchmark_flush_everything = false;
+static const u8* s_benchmark_working_set = nullptr;
+
+// Each switch back to a process is followed by a read from every page of the working set,
+// so the cost of refilling the TLB shows up next to the cost of the switch itself
+static void touch_working_set(const u8* working_set)
+{
+    for (size_t i = 0; i < kBenchmarkTouchedPages; i++) {
+        (void)*(volatile const u8*)(working_set + i * Memory::kPageSize);
+    }
+}
+
+static void benchmark_switch(const u8* working_set)
+{
+    // Emulates switching before global pages and the CR3 check, when every switch emptied the TLB
+    if (s_benchmark_flush_everything) {
+        Memory::flush_global_tlb();
+    }
+    PM.yield();
+    touch_working_set(working_set);
+}
+
+[[noreturn]] static void context_switch_benchmark_partner()
+{
+    while (s_benchmark_running) {
+        benchmark_switch(s_benchmark_working_set);
+    }
+
+    PM.current_process().set_state(Process::Dead);
+    PM.yield();
+    while (true) { }
+}
+
+static u32 measure_round_trip_cycles(bool flush_everything)
+{
+    s_benchmark_flush_everything = flush_everything;
+
+    u64 start = CPU::read_timestamp_counter();
+    for (size_t i = 0; i < kBenchmarkRoundTrips; i++) {
+        benchmark_switch(s_benchmark_working_set);
+    }
+    return (u32)(CPU::read_timestamp_counter() - start) / kBenchmarkRoundTrips;
+}
+
+// Ping-pongs between two kernel processes, which share the kernel page directory
+static void benchmark_context_switch()
+{
+    auto working_set = MM.allocate_kernel_region(kBenchmarkTouchedPages * Memory::kPageSize);
+    s_benchmark_working_set = working_set->lower().ptr();
+    s_benchmark_running = true;
+    MUST(Process::create_kernel_process("SwitchBenchmark", context_switch_benchmark_partner));
+
+    u32 shared_cycles = measure_round_trip_cycles(false);
+    u32 flushed_cycles = measure_round_trip_cycles(true);
+    s_benchmark_running = false;
+    PM.yield();
+
+    dbgprintf("Kernel", "Context switch benchmark: %u round trips touching %u pages\n", kBenchmarkRoundTrips, kBenchmarkTouchedPages);
+    dbgprintf("Kernel", "  Shared directory, global pages: %u cycles\n", shared_cycles);
+    dbgprintf("Kernel", "  Full TLB flush on every switch: %u cycles\n", flushed_cycles);
+
+    MM.free_kernel_region(*working_set);
+}
+#endif
+
 [[noreturn]] static void kernel_main()
 {
+#if BENCHMARK_CONTEXT_SWITCH
+    benchmark_context_switch();
+#endif
+
     // TODO: Only text-mode is supported currently
     // GraphicsManager::the().init();
 
@@ -51,6 +128,8 @@ VirtualConsole* tty0;
         Process::create_kernel_process("NetworkDaemon", Network::NetworkDaemon::start);
     }
 
+    Process::create_kernel_process("PageMerger", PageMerger::start);
+
     KeyboardDevice::the();
 
     tty0 = new VirtualConsole(0);
@@ -94,6 +173,8 @@ extern "C" [[noreturn]] void kernel_entry(u32* boot_page_directory, const multib
 
     MemoryManager::init(boot_page_directory, multiboot);
 
+    kmalloc_enable_growth();
+
     Process::create_kernel_process("KernelMain", kernel_main);
 
     PM.start();
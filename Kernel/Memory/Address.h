@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <Kernel/Memory/PagingTypes.h>
 #include <Universal/Types.h>
 
 #define PAGE_DIRECTORY_INDEX(virtual_address) ((((u32)virtual_address.get()) >> 22) & 0x3ff);
@@ -66,8 +67,11 @@ public:
     void add(u32 a) { m_address += a; }
     PhysicalAddress offset(u32 offset) const { return PhysicalAddress(m_address + offset); }
 
-    u8* ptr() { return reinterpret_cast<u8*>(m_address); }
-    const u8* ptr() const { return reinterpret_cast<const u8*>(m_address); }
+    bool is_null() const { return m_address == 0; }
+
+    // Only valid for memory inside the kernel's direct map
+    u8* ptr() { return reinterpret_cast<u8*>(Memory::physical_to_virtual(m_address)); }
+    const u8* ptr() const { return reinterpret_cast<const u8*>(Memory::physical_to_virtual(m_address)); }
 
     u32 page_base() const { return m_address & 0xfffff000; }
 
@@ -9,7 +9,7 @@
 
 AddressAllocator::AddressAllocator(VirtualAddress base, size_t length)
 {
-    m_ranges.add_last(AddressRange(base, length));
+    add_range(base.get(), length);
 }
 
 Expected<AddressRange> AddressAllocator::allocate(size_t length)
@@ -22,30 +22,23 @@ Expected<AddressRange> AddressAllocator::allocate(size_t length)
     //       that much anyways. Maybe don't do this in the future
     length = Memory::page_round_up(length);
 
-    int i;
-    for (i = 0; i < m_ranges.size(); i++) {
-        if (length <= m_ranges[i].length()) {
-            break;
-        }
-    }
-
-    if (i >= m_ranges.size()) {
+    auto* best_fit = m_ranges_by_length.find_smallest_not_below({ length, 0 });
+    if (best_fit == nullptr) {
         return Result(Status::Failure);
     }
 
-    AddressRange address_range_found = m_ranges[i];
-    m_ranges.remove(i);
+    u32 base = best_fit->value().get();
+    size_t range_length = best_fit->key().length;
 
-    if (address_range_found.length() == length) {
-        return address_range_found;
+    remove_range(m_ranges_by_address.find(base));
+    if (range_length > length) {
+        add_range(base + length, range_length - length);
     }
 
-    m_ranges.add(i, AddressRange(address_range_found.lower().offset(length), address_range_found.length() - length));
-
 #if DEBUG_ADDRESS_ALLOCATOR
     dump();
 #endif
-    return AddressRange(address_range_found.lower(), length);
+    return AddressRange(base, length);
 }
 
 Expected<AddressRange> AddressAllocator::allocate_at(VirtualAddress address, size_t length)
@@ -54,35 +47,27 @@ Expected<AddressRange> AddressAllocator::allocate_at(VirtualAddress address, siz
         return Result(Status::Failure);
     }
 
-    int i;
-    for (i = 0; i < m_ranges.size(); i++) {
-        if (m_ranges[i].lower() <= address && address <= m_ranges[i].upper()) {
-            break;
-        }
-    }
-
-    if (i >= m_ranges.size()) {
+    auto* range = m_ranges_by_address.find_largest_not_above(address.get());
+    if (range == nullptr) {
         dbgprintf("AddressAllocator", "Not good!\n");
         return Result(Status::Failure);
     }
 
-    AddressRange address_range_found = m_ranges[i];
-
-    if (address_range_found.upper() - address < length) {
+    u32 range_base = range->key();
+    u32 range_upper = range_base + range->value();
+    if (range_upper < address.get() || range_upper - address.get() < length) {
         return Result(Status::Failure);
     }
 
-    m_ranges.remove(i);
+    remove_range(range);
 
-    size_t length_before_address = address - address_range_found.lower();
-    size_t length_after_address = address_range_found.upper() - address.offset(length);
-    if (length_after_address > 0 && length_before_address == 0) {
-        m_ranges.add(i, AddressRange(address_range_found.lower().offset(length), length_after_address));
-    } else if (length_after_address == 0 && length_before_address > 0) {
-        m_ranges.add(i, AddressRange(address_range_found.lower(), length_before_address));
-    } else if (length_after_address > 0 && length_before_address > 0) {
-        m_ranges.add(i, AddressRange(address_range_found.lower().offset(length_before_address + length), length_after_address));
-        m_ranges.add(i, AddressRange(address_range_found.lower(), length_before_address));
+    size_t length_before_address = address.get() - range_base;
+    size_t length_after_address = range_upper - (address.get() + length);
+    if (length_before_address > 0) {
+        add_range(range_base, length_before_address);
+    }
+    if (length_after_address > 0) {
+        add_range(address.get() + length, length_after_address);
     }
 
 #if DEBUG_ADDRESS_ALLOCATOR
@@ -91,37 +76,57 @@ Expected<AddressRange> AddressAllocator::allocate_at(VirtualAddress address, siz
     return AddressRange(address, length);
 }
 
-Result AddressAllocator::free(AddressRange address_range)
+Expected<AddressRange> AddressAllocator::allocate_aligned(size_t length, size_t alignment)
 {
-    for (int i = 0; i < m_ranges.size(); i++) {
-        if (m_ranges[i].upper() == address_range.lower()) {
-            m_ranges[i].add_length(address_range.length());
-            goto merge;
-        }
+    if (length == 0 || alignment == 0 || alignment % Memory::kPageSize != 0) {
+        return Result(Status::Failure);
     }
-    m_ranges.add_last(address_range);
 
-merge:
-    m_ranges.sort([&](auto& a, auto& b) {
-        return a.lower() > b.lower();
-    });
+    length = Memory::page_round_up(length);
 
-    ArrayList<AddressRange> merged_ranges;
-    for (int i = 0; i < m_ranges.size(); i++) {
-        if (merged_ranges.is_empty()) {
-            merged_ranges.add_last(m_ranges[i]);
-            continue;
+    // Walk up from the best fit until a range has room for the block once its base is aligned
+    for (auto* range = m_ranges_by_length.find_smallest_not_below({ length, 0 }); range != nullptr; range = LengthTree::next(range)) {
+        u32 base = range->value().get();
+        size_t padding = base % alignment == 0 ? 0 : alignment - base % alignment;
+        if (padding <= range->key().length - length) {
+            return allocate_at(base + padding, length);
         }
+    }
 
-        if (m_ranges[i].lower() == merged_ranges.last().upper()) {
-            merged_ranges.last().add_length(m_ranges[i].length());
-            continue;
-        }
+    return Result(Status::Failure);
+}
 
-        merged_ranges.add_last(m_ranges[i]);
+Result AddressAllocator::free(AddressRange address_range)
+{
+    u32 base = address_range.lower().get();
+    size_t length = address_range.length();
+    if (length == 0) {
+        return Status::Failure;
+    }
+
+    auto* next = m_ranges_by_address.find_smallest_not_below(base);
+    auto* previous = next != nullptr ? AddressTree::previous(next) : m_ranges_by_address.last();
+
+    // Refuse ranges that overlap memory which is already free
+    if (next != nullptr && base + length > next->key()) {
+        return Status::Failure;
+    }
+    if (previous != nullptr && previous->key() + previous->value() > base) {
+        return Status::Failure;
+    }
+
+    if (previous != nullptr && previous->key() + previous->value() == base) {
+        base = previous->key();
+        length += previous->value();
+        remove_range(previous);
     }
 
-    m_ranges = move(merged_ranges);
+    if (next != nullptr && base + length == next->key()) {
+        length += next->value();
+        remove_range(next);
+    }
+
+    add_range(base, length);
 
 #if DEBUG_ADDRESS_ALLOCATOR
     dump();
@@ -129,12 +134,25 @@ merge:
     return Status::OK;
 }
 
+void AddressAllocator::add_range(u32 base, size_t length)
+{
+    m_ranges_by_address.insert(base, length);
+    m_ranges_by_length.insert({ length, base }, VirtualAddress(base));
+}
+
+void AddressAllocator::remove_range(AddressTree::Node* range)
+{
+    m_ranges_by_length.remove(m_ranges_by_length.find({ range->value(), range->key() }));
+    m_ranges_by_address.remove(range);
+}
+
 #if DEBUG_ADDRESS_ALLOCATOR
 void AddressAllocator::dump()
 {
     dbgprintf("AddressAllocator", "Dumping address ranges:\n");
-    for (int i = 0; i < m_ranges.size(); i++) {
-        dbgprintf("AddressAllocator", "  %u: 0x%x - 0x%x\n", i, m_ranges[i].lower(), m_ranges[i].upper());
+    size_t i = 0;
+    for (auto* range = m_ranges_by_address.first(); range != nullptr; range = AddressTree::next(range), i++) {
+        dbgprintf("AddressAllocator", "  %u: 0x%x - 0x%x\n", i, range->key(), range->key() + range->value());
     }
 }
 #endif
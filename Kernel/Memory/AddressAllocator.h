@@ -7,8 +7,9 @@
 #pragma once
 
 #include <Kernel/Memory/Address.h>
-#include <Universal/ArrayList.h>
+#include <Universal/Expected.h>
 #include <Universal/Logger.h>
+#include <Universal/RedBlackTree.h>
 #include <Universal/Result.h>
 #include <Universal/Types.h>
 
@@ -34,7 +35,7 @@ public:
 
 private:
     VirtualAddress m_base;
-    size_t m_length;
+    size_t m_length { 0 };
 };
 
 class AddressAllocator {
@@ -45,12 +46,36 @@ public:
 
     Expected<AddressRange> allocate_at(VirtualAddress, size_t);
 
+    // Alignment must be a multiple of the page size
+    Expected<AddressRange> allocate_aligned(size_t, size_t alignment);
+
     Result free(AddressRange);
 
+    size_t free_range_count() const { return m_ranges_by_address.size(); }
+
 private:
+    struct LengthKey {
+        size_t length;
+        u32 base;
+
+        bool operator<(const LengthKey& other) const
+        {
+            return length < other.length || (length == other.length && base < other.base);
+        }
+    };
+
+    using AddressTree = RedBlackTree<u32, size_t>;
+    using LengthTree = RedBlackTree<LengthKey, VirtualAddress>;
+
+    void add_range(u32 base, size_t length);
+    void remove_range(AddressTree::Node*);
+
 #if DEBUG_ADDRESS_ALLOCATOR
     void dump();
 #endif
 
-    ArrayList<AddressRange> m_ranges;
+    // Free ranges are indexed twice: by base address for fixed address allocations and
+    // coalescing on free, and by length so allocate() can find the best fit
+    AddressTree m_ranges_by_address;
+    LengthTree m_ranges_by_length;
 };
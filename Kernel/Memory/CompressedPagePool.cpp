@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2025, Jason Long <jasonlongball@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <Kernel/CPU/CPU.h>
+#include <Kernel/Memory/CompressedPagePool.h>
+#include <Universal/LZ.h>
+#include <Universal/Logger.h>
+#include <Universal/Number.h>
+#include <Universal/Stdlib.h>
+
+using namespace Memory;
+
+CompressedPagePool::CompressedPagePool(size_t limit)
+    : m_limit(min(limit, kMaxLimit))
+{
+    m_scratch = static_cast<u8*>(kmalloc(kMaxCompressedLength));
+}
+
+CompressedPagePool::~CompressedPagePool()
+{
+    kfree(m_scratch);
+}
+
+void CompressedPagePool::set_limit(size_t limit)
+{
+    m_limit = min(limit, kMaxLimit);
+}
+
+Expected<u32> CompressedPagePool::store(const u8* page)
+{
+    if (is_full()) {
+        return Result(kOutOfMemory);
+    }
+
+    u64 start = CPU::read_timestamp_counter();
+    size_t length = LZ::compress(page, kPageSize, m_scratch, kMaxCompressedLength);
+    record_latency(m_compression_cycles, start);
+    m_compressions++;
+
+    if (length == 0) {
+        m_rejected_pages++;
+        return Result(Status::Failure);
+    }
+    return store_compressed(m_scratch, length);
+}
+
+Expected<u32> CompressedPagePool::store_compressed(const u8* data, size_t length)
+{
+    CompressedPage compressed_page = {};
+    compressed_page.length = length;
+
+    for (size_t i = 0; i * kChunkSize < length; i++) {
+        size_t chunk_length = min(kChunkSize, length - i * kChunkSize);
+        compressed_page.chunks[i] = static_cast<u8*>(kmalloc(chunk_length));
+        if (compressed_page.chunks[i] == nullptr) {
+            // The kernel heap could not grow, the swap partition can still take the page
+            for (size_t j = 0; j < i; j++) {
+                kfree(compressed_page.chunks[j]);
+            }
+            return Result(kOutOfMemory);
+        }
+        memcpy(compressed_page.chunks[i], data + i * kChunkSize, chunk_length);
+    }
+
+    u32 handle;
+    if (!m_free_handles.is_empty()) {
+        handle = m_free_handles.last();
+        m_free_handles.remove(m_free_handles.size() - 1);
+        m_pages[handle] = compressed_page;
+    } else {
+        handle = m_pages.size();
+        m_pages.add_last(compressed_page);
+    }
+
+    m_stored_pages++;
+    m_stored_bytes += length;
+    return handle;
+}
+
+Result CompressedPagePool::load(u32 handle, u8* page)
+{
+    auto& compressed_page = m_pages[handle];
+    ASSERT(compressed_page.length != 0);
+    gather(compressed_page, m_scratch);
+
+    u64 start = CPU::read_timestamp_counter();
+    bool is_ok = LZ::decompress(m_scratch, compressed_page.length, page, kPageSize);
+    record_latency(m_decompression_cycles, start);
+    m_decompressions++;
+
+    return is_ok ? Status::OK : Status::Failure;
+}
+
+Expected<u32> CompressedPagePool::duplicate(u32 handle)
+{
+    auto& compressed_page = m_pages[handle];
+    gather(compressed_page, m_scratch);
+
+    // A copy never needs the limit checked, the child's pages are the parent's pages
+    return store_compressed(m_scratch, compressed_page.length);
+}
+
+void CompressedPagePool::free(u32 handle)
+{
+    auto& compressed_page = m_pages[handle];
+    ASSERT(compressed_page.length != 0);
+
+    for (size_t i = 0; i * kChunkSize < compressed_page.length; i++) {
+        kfree(compressed_page.chunks[i]);
+    }
+
+    m_stored_pages--;
+    m_stored_bytes -= compressed_page.length;
+    compressed_page = {};
+    m_free_handles.add_last(handle);
+}
+
+void CompressedPagePool::gather(const CompressedPage& compressed_page, u8* data) const
+{
+    for (size_t i = 0; i * kChunkSize < compressed_page.length; i++) {
+        memcpy(data + i * kChunkSize, compressed_page.chunks[i], min(kChunkSize, compressed_page.length - i * kChunkSize));
+    }
+}
+
+void CompressedPagePool::record_latency(u32& average_cycles, u64 start)
+{
+    u32 cycles = (u32)(CPU::read_timestamp_counter() - start);
+    average_cycles = average_cycles == 0 ? cycles : average_cycles - average_cycles / 8 + cycles / 8;
+}
+
+void CompressedPagePool::dump_statistics() const
+{
+    // Compressed size as a percentage of the original, averaged over the pages held right now
+    u32 ratio = m_stored_pages != 0 ? (m_stored_bytes / m_stored_pages) * 100 / kPageSize : 0;
+
+    dbgprintf("CompressedPagePool", "%u pages in %u/%u KiB, %u%% of their size\n", m_stored_pages, m_stored_bytes / KB, m_limit / KB, ratio);
+    dbgprintf("CompressedPagePool", "  Compressed %u pages (%u did not fit), %u cycles each\n", m_compressions, m_rejected_pages, m_compression_cycles);
+    dbgprintf("CompressedPagePool", "  Decompressed %u pages, %u cycles each\n", m_decompressions, m_decompression_cycles);
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2025, Jason Long <jasonlongball@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <Kernel/Memory/PagingTypes.h>
+#include <Kernel/kmalloc.h>
+#include <Universal/ArrayList.h>
+#include <Universal/Expected.h>
+
+// Evicted pages kept compressed in kmalloc memory, so most swap-ins never have to touch the
+// disk. Compressed data is split into slab sized chunks, since anything bigger than a slab
+// object would take a whole page and save nothing.
+class CompressedPagePool {
+public:
+    static constexpr size_t kChunkSize = KMALLOC_MAX_SLAB_OBJECT_SIZE;
+    static constexpr size_t kMaxChunks = 3;
+    // Pages that do not compress to this are left for the swap partition
+    static constexpr size_t kMaxCompressedLength = kChunkSize * kMaxChunks;
+    // The chunks share the kernel heap with everything else, so the pool never gets more than a
+    // quarter of what the heap can grow to, however much RAM there is
+    static constexpr size_t kMaxLimit = KMALLOC_MAX_ARENA_COUNT * KMALLOC_ARENA_SIZE / 4;
+
+    CompressedPagePool(size_t limit);
+    ~CompressedPagePool();
+
+    // Compressed bytes the pool may hold up to kMaxLimit, 0 turns it off
+    size_t limit() const { return m_limit; }
+    void set_limit(size_t limit);
+    bool is_full() const { return m_stored_bytes + kMaxCompressedLength > m_limit; }
+
+    size_t stored_pages() const { return m_stored_pages; }
+    size_t stored_bytes() const { return m_stored_bytes; }
+
+    // Returns a handle for the page, or fails when the pool is full or the page does not compress
+    Expected<u32> store(const u8* page);
+    Result load(u32 handle, u8* page);
+    Expected<u32> duplicate(u32 handle);
+    void free(u32 handle);
+
+    void dump_statistics() const;
+
+private:
+    struct CompressedPage {
+        u8* chunks[kMaxChunks];
+        u16 length;
+    };
+
+    Expected<u32> store_compressed(const u8* data, size_t length);
+    void gather(const CompressedPage&, u8* data) const;
+    static void record_latency(u32& average_cycles, u64 start);
+
+    ArrayList<CompressedPage> m_pages;
+    ArrayList<u32> m_free_handles;
+    u8* m_scratch { nullptr };
+
+    size_t m_limit { 0 };
+    size_t m_stored_pages { 0 };
+    size_t m_stored_bytes { 0 };
+
+    // Latencies are moving averages, so they follow the pages currently being swapped
+    size_t m_rejected_pages { 0 };
+    size_t m_compressions { 0 };
+    u32 m_compression_cycles { 0 };
+    size_t m_decompressions { 0 };
+    u32 m_decompression_cycles { 0 };
+};
@@ -4,9 +4,15 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#include <Kernel/CPU/CPU.h>
 #include <Kernel/CPU/IDT.h>
 #include <Kernel/Memory/MemoryManager.h>
+#include <Kernel/Memory/PageMerger.h>
 #include <Kernel/Memory/PagingTypes.h>
+#include <Kernel/Memory/UserCopy.h>
+#include <Kernel/Process/ProcessManager.h>
+#include <Kernel/kmalloc.h>
+#include <LibC/sys/syscall_defines.h>
 #include <Universal/Assert.h>
 #include <Universal/Logger.h>
 #include <Universal/Number.h>
@@ -28,12 +34,32 @@ MemoryManager::MemoryManager()
 {
 }
 
-static void page_fault_exception_handler(const InterruptRegisters& regs)
+static void page_fault_exception_handler(InterruptRegisters& regs)
 {
     u32 fault_address;
     asm volatile("mov %0, cr2"
                  : "=r"(fault_address));
 
+    PageFault fault(regs.error_number, fault_address);
+    if (MM.handle_page_fault(fault).is_ok()) {
+        return;
+    }
+
+    // A bad pointer handed to the user copy routines makes them return an error instead
+    u32 fixup_address = find_user_copy_fixup(regs.frame.eip);
+    if (fixup_address != 0) {
+        regs.frame.eip = fixup_address;
+        return;
+    }
+
+    // A process that touched memory it does not have, or that could not be backed, is killed
+    // instead of taking the kernel down with it
+    if (fault.is_user() && ProcessManager::started()) {
+        dbgprintf("MemoryManager", "Unhandled user page fault at 0x%x, error %u\n", fault_address, regs.error_number);
+        PM.current_process().crash();
+        PM.yield();
+    }
+
     if (fault_address == 0x0) {
         panic("Dereference of null pointer caused page fault\n");
     }
@@ -47,6 +73,8 @@ void MemoryManager::init(u32* boot_page_directory, const multiboot_information_t
     }
 
     the().internal_init(boot_page_directory, multiboot);
+    enable_write_protect();
+    enable_global_pages();
     IDT::register_exception_handler(EXCEPTION_PAGE_FAULT, page_fault_exception_handler);
 }
 
@@ -58,15 +86,14 @@ void MemoryManager::internal_init(u32* boot_page_directory, const multiboot_info
 
     m_kernel_page_directory = PageDirectory::create_kernel_page_directory(Memory::virtual_to_physical(reinterpret_cast<u32>(boot_page_directory)));
 
-    // Physical Memory Layout (4 MiB):
-    //     Kernel Image (Varies)
-    //     kmalloc Space (1 MiB)
-    //     User physical memory region bitmap
-    //     Kernel physical memory region bitmap
-    //     Free kernel pages
+    // Physical Memory Layout:
+    //     Kernel Image including the kmalloc space (3 MiB)
+    //     Kernel pages, direct mapped and also handed out to users (up to kKernelDirectMapMaxLength)
+    //     User only pages, reachable by the kernel through temporary mappings
 
     u32 physical_region_base = 0;
     u32 physical_region_length = 0;
+    u32 physical_memory_end = 0;
 
     dbgprintf("MemoryManager", "Kernel image: 0x%x - 0x%x (%u KiB)\n", kKernelVirtualBase, &g_kernel_end, ((u32)&g_kernel_end - kKernelVirtualBase) / 1024);
     dbgprintf("MemoryManager", "System Memory Map: lower_mem=%d KiB upper_mem=%d MiB\n", multiboot->memory_lower, multiboot->memory_upper / 1024);
@@ -107,6 +134,7 @@ void MemoryManager::internal_init(u32* boot_page_directory, const multiboot_info
 
         physical_region_base = (u32)(mmap->base_address & 0xffffffff);
         physical_region_length = (u32)(mmap->length & 0xffffffff);
+        physical_memory_end = max(physical_memory_end, physical_region_base + physical_region_length);
 
         SharedPtr<PhysicalRegion> current_region;
         bool current_region_is_kernel = false;
@@ -119,7 +147,7 @@ void MemoryManager::internal_init(u32* boot_page_directory, const multiboot_info
                 continue;
             }
 
-            if (page_base >= kKernelImageMaxLength && page_base < kKernelImageMaxLength + (1 * MB)) {
+            if (page_base < kKernelDirectMapMaxLength) {
                 if (!current_region_is_kernel || current_region.is_null() || current_region->upper().offset(kPageSize) != address) {
                     m_kernel_physical_regions.add_last(PhysicalRegion::create(address, address));
                     current_region = m_kernel_physical_regions.last();
@@ -139,15 +167,22 @@ void MemoryManager::internal_init(u32* boot_page_directory, const multiboot_info
         }
     }
 
+    direct_map(min(physical_memory_end, (u32)kKernelDirectMapMaxLength));
+
+    create_page_frame_database(physical_memory_end);
+
+    // Frames record their region as an index into the kernel regions followed by the user regions
+    ASSERT(m_kernel_physical_regions.size() + m_user_physical_regions.size() < PageFrame::kNoRegion);
+
     dbgprintf_if(DEBUG_MEMORY_MANAGER, "MemoryManager", "Physical Kernel Regions:\n");
     for (size_t i = 0; i < m_kernel_physical_regions.size(); i++) {
-        m_kernel_physical_regions[i]->commit();
+        m_kernel_physical_regions[i]->commit(page_frame(m_kernel_physical_regions[i]->lower()), i);
         dbgprintf_if(DEBUG_MEMORY_MANAGER, "MemoryManager", "  Region %u: 0x%08x:0x%08x\n", i, m_kernel_physical_regions[i]->lower(), m_kernel_physical_regions[i]->upper());
     }
 
     dbgprintf_if(DEBUG_MEMORY_MANAGER, "MemoryManager", "Physical User Regions:\n");
     for (size_t i = 0; i < m_user_physical_regions.size(); i++) {
-        m_user_physical_regions[i]->commit();
+        m_user_physical_regions[i]->commit(page_frame(m_user_physical_regions[i]->lower()), m_kernel_physical_regions.size() + i);
         dbgprintf_if(DEBUG_MEMORY_MANAGER, "MemoryManager", "  Region %u: 0x%08x:0x%08x\n", i, m_user_physical_regions[i]->lower(), m_user_physical_regions[i]->upper());
     }
 
@@ -156,20 +191,107 @@ void MemoryManager::internal_init(u32* boot_page_directory, const multiboot_info
 
     // Ensure null pointer dereferences page fault
     protected_map(*m_kernel_page_directory, 0, kPageSize);
+
+    preallocate_kernel_page_tables();
+
+    m_temporary_map_entries = &get_page_table_entry(*m_kernel_page_directory, kKernelTemporaryMapBase, true);
+
+    m_compressed_pages = make_unique_ptr<CompressedPagePool>(free_physical_page_count() / 100 * kCompressedPoolPercent * kPageSize);
 }
 
-PhysicalAddress MemoryManager::allocate_physical_kernel_page()
+Expected<PhysicalAddress> MemoryManager::allocate_physical_page_from(ArrayList<SharedPtr<PhysicalRegion>>& regions)
 {
-    Expected<PhysicalAddress> page_result;
-    for (int i = 0; i < m_kernel_physical_regions.size(); i++) {
-        page_result = m_kernel_physical_regions[i]->allocate_page();
+    for (size_t i = 0; i < regions.size(); i++) {
+        auto page_result = regions[i]->allocate_page();
         if (page_result.is_ok()) {
-            break;
+            return page_result;
         }
     }
+    return Result(Status::Failure);
+}
 
-    ASSERT(page_result.is_ok());
-    memset(page_result.value().ptr(), 0, kPageSize);
+void MemoryManager::create_page_frame_database(u32 physical_memory_end)
+{
+    m_page_frame_count = physical_memory_end / kPageSize;
+    size_t database_pages = ceiling_divide(m_page_frame_count * sizeof(PageFrame), kPageSize);
+
+    // The database is carved off the front of the first kernel region, which is direct mapped
+    ASSERT(!m_kernel_physical_regions.is_empty());
+    auto& region = m_kernel_physical_regions[0];
+    ASSERT(region->page_count() > database_pages);
+
+    auto database_base = region->lower();
+    region->expand(database_base.offset(database_pages * kPageSize), region->upper());
+
+    m_page_frames = reinterpret_cast<PageFrame*>(database_base.ptr());
+    for (u32 i = 0; i < m_page_frame_count; i++) {
+        new (&m_page_frames[i]) PageFrame();
+    }
+
+    dbgprintf("MemoryManager", "Page frame database: %u frames in %u pages @ 0x%x\n", m_page_frame_count, database_pages, database_base);
+}
+
+void MemoryManager::preallocate_kernel_page_tables()
+{
+    // Everything above the direct map is mapped with page tables. Creating all of them now
+    // means new address spaces can share them just by copying the kernel's directory entries.
+    auto* entries = m_kernel_page_directory->entries();
+    for (u32 index = kKernelTemporaryMapBase / kLargePageSize; index < kPageTableEntryCount; index++) {
+        if (!entries[index].is_present()) {
+            get_page_table(*m_kernel_page_directory, index * kLargePageSize, false);
+        }
+    }
+
+    m_kernel_page_tables_preallocated = true;
+}
+
+PageFrame* MemoryManager::page_frame(PhysicalAddress address)
+{
+    u32 frame_number = address.get() / kPageSize;
+    if (frame_number >= m_page_frame_count) {
+        return nullptr;
+    }
+    return &m_page_frames[frame_number];
+}
+
+void MemoryManager::direct_map(u32 length)
+{
+    enable_page_size_extension();
+
+    // Covers the boot mapping of the first 4 MiB as well, with the same translations
+    auto* entries = m_kernel_page_directory->entries();
+    for (u32 physical_address = 0; physical_address < length; physical_address += kLargePageSize) {
+        auto& page_directory_entry = entries[(physical_to_virtual(physical_address) >> 22) & 0x3ff];
+        page_directory_entry.set_large_page_base(physical_address);
+        page_directory_entry.set_large_page(true);
+        page_directory_entry.set_global(true);
+        page_directory_entry.set_user(false);
+        page_directory_entry.set_present(true);
+        page_directory_entry.set_read_write(true);
+    }
+    flush_tlb();
+
+    dbgprintf("MemoryManager", "Direct mapped %u MiB of physical memory at 0x%x\n", ceiling_divide(length, kLargePageSize) * 4, kKernelVirtualBase);
+}
+
+PhysicalAddress MemoryManager::allocate_physical_kernel_page()
+{
+    auto page_result = m_zeroed_kernel_pages.take();
+    if (page_result.is_error()) {
+        page_result = allocate_physical_page_from(m_kernel_physical_regions);
+
+        // Under memory pressure, take back the kmalloc arenas that are sitting idle before giving up
+        if (page_result.is_error() && kmalloc_release_idle_arenas() > 0) {
+            return allocate_physical_kernel_page();
+        }
+
+        ASSERT(page_result.is_ok());
+        memset(page_result.value().ptr(), 0, kPageSize);
+    }
+
+    auto& frame = *page_frame(page_result.value());
+    frame.set_flag(PageFrame::Zeroed, false);
+    frame.set_flag(PageFrame::Kernel, true);
     return page_result.value();
 }
 
@@ -183,52 +305,396 @@ PhysicalAddress MemoryManager::allocate_physical_contiguous_kernel_pages(u32 num
         }
     }
 
+    if (page_result.is_error() && kmalloc_release_idle_arenas() > 0) {
+        return allocate_physical_contiguous_kernel_pages(number_of_pages);
+    }
+
     ASSERT(page_result.is_ok());
-    // memset(page_result.value().ptr(), 0, Types::PageSize);
+
+    // Contiguous runs are handed to devices, so they must stay where they are
+    for (u32 i = 0; i < number_of_pages; i++) {
+        auto& frame = *page_frame(page_result.value().offset(i * kPageSize));
+        frame.set_flag(PageFrame::Kernel, true);
+        frame.set_flag(PageFrame::Pinned, true);
+    }
     return page_result.value();
 }
 
 Result MemoryManager::free_physical_kernel_page(PhysicalAddress address)
 {
-    bool found_region = false;
-    for (size_t i = 0; i < m_kernel_physical_regions.size(); i++) {
-        auto region = m_kernel_physical_regions[i];
-        if (region->includes(address)) {
-            TRY(region->free_page(address));
-            found_region = true;
+    auto* region = find_physical_region(address);
+    if (region == nullptr) {
+        return Status::Failure;
+    }
+    return region->free_page(address);
+}
+
+Expected<PhysicalAddress> MemoryManager::allocate_physical_user_page()
+{
+    // Trade a cold user page for every new one once memory runs low
+    if (can_swap() && free_physical_page_count() < kSwapLowWatermarkPages) {
+        (void)evict_user_page();
+    }
+
+    // Keep the direct mapped pages for the kernel while there are pages only users can have
+    auto page_result = allocate_physical_page_from(m_user_physical_regions);
+    if (page_result.is_error()) {
+        page_result = allocate_physical_page_from(m_kernel_physical_regions);
+    }
+
+    // A zeroed page is still better than no page at all
+    if (page_result.is_error() && !m_zeroed_user_pages.is_empty()) {
+        page_result = m_zeroed_user_pages.take();
+        page_frame(page_result.value())->set_flag(PageFrame::Zeroed, false);
+    }
+
+    if (page_result.is_error()) {
+        dbgprintf("MemoryManager", "Out of user pages!\n");
+    }
+    return page_result;
+}
+
+Expected<PhysicalAddress> MemoryManager::allocate_zeroed_physical_user_page()
+{
+    auto pooled_page = m_zeroed_user_pages.take();
+    if (pooled_page.is_ok()) {
+        page_frame(pooled_page.value())->set_flag(PageFrame::Zeroed, false);
+        return pooled_page.value();
+    }
+
+    auto physical_page = TRY_TAKE(allocate_physical_user_page());
+    MUST(zero_physical_page(physical_page));
+    return physical_page;
+}
+
+Expected<PhysicalAddress> MemoryManager::allocate_physical_user_large_page()
+{
+    static constexpr u32 kLargePagePages = kLargePageSize / kPageSize;
+
+    Expected<PhysicalAddress> page_result = Result(Status::Failure);
+    for (size_t i = 0; i < m_user_physical_regions.size() && page_result.is_error(); i++) {
+        page_result = m_user_physical_regions[i]->allocate_aligned_pages(kLargePagePages, kLargePageSize);
+    }
+    for (size_t i = 0; i < m_kernel_physical_regions.size() && page_result.is_error(); i++) {
+        page_result = m_kernel_physical_regions[i]->allocate_aligned_pages(kLargePagePages, kLargePageSize);
+    }
+
+    if (page_result.is_error()) {
+        return page_result;
+    }
+
+    // The frames are mapped as a whole from the page directory, so they are never
+    // shared, swapped or counted page by page
+    for (u32 i = 0; i < kLargePagePages; i++) {
+        auto physical_page = page_result.value().offset(i * kPageSize);
+        page_frame(physical_page)->set_flag(PageFrame::Pinned, true);
+        MUST(zero_physical_page(physical_page));
+    }
+    return page_result;
+}
+
+Result MemoryManager::zero_physical_page(PhysicalAddress physical_page)
+{
+    if (is_direct_mapped(physical_page)) {
+        memset(physical_page.ptr(), 0, kPageSize);
+        return Status::OK;
+    }
+
+    // Pages above the direct map are only reachable through a temporary mapping
+    auto mapped_page = TRY_TAKE(temporary_map(physical_page));
+    memset(mapped_page.ptr(), 0, kPageSize);
+    temporary_unmap(mapped_page);
+    return Status::OK;
+}
+
+Result MemoryManager::free_physical_user_page(PhysicalAddress address)
+{
+    auto* region = find_physical_region(address);
+    if (region == nullptr) {
+        return Status::Failure;
+    }
+    return region->free_page(address);
+}
+
+Result MemoryManager::share_physical_user_page(PhysicalAddress address)
+{
+    auto* region = find_physical_region(address);
+    if (region == nullptr) {
+        return Status::Failure;
+    }
+    return region->share_page(address);
+}
+
+u16 MemoryManager::physical_user_page_share_count(PhysicalAddress address)
+{
+    auto* region = find_physical_region(address);
+    if (region == nullptr) {
+        return 0;
+    }
+    return region->share_count(address);
+}
+
+void MemoryManager::refill_zeroed_page_pools()
+{
+    // Pages are zeroed one at a time with interrupts disabled so an interrupt is never delayed for long
+    while (!m_zeroed_kernel_pages.is_full()) {
+        CPU::InterruptDisabler interrupt_disabler;
+        auto page_result = allocate_physical_page_from(m_kernel_physical_regions);
+        if (page_result.is_error()) {
+            break;
+        }
+
+        memset(page_result.value().ptr(), 0, kPageSize);
+        page_frame(page_result.value())->set_flag(PageFrame::Zeroed, true);
+        m_zeroed_kernel_pages.add(page_result.value());
+    }
+
+    while (!m_zeroed_user_pages.is_full()) {
+        CPU::InterruptDisabler interrupt_disabler;
+        auto page_result = allocate_physical_page_from(m_user_physical_regions);
+        if (page_result.is_error()) {
+            page_result = allocate_physical_page_from(m_kernel_physical_regions);
+        }
+        if (page_result.is_error()) {
+            break;
+        }
+
+        if (zero_physical_page(page_result.value()).is_error()) {
+            MUST(free_physical_user_page(page_result.value()));
             break;
         }
+        page_frame(page_result.value())->set_flag(PageFrame::Zeroed, true);
+        m_zeroed_user_pages.add(page_result.value());
     }
-    return found_region ? Status::OK : Status::Failure;
 }
 
-PhysicalAddress MemoryManager::allocate_physical_user_page()
+void MemoryManager::dump_physical_memory_statistics() const
 {
-    Expected<PhysicalAddress> page_result;
-    for (int i = 0; i < m_user_physical_regions.size(); i++) {
-        page_result = m_user_physical_regions[i]->allocate_page();
-        if (page_result.is_ok()) {
-            break;
+    dbgprintf("MemoryManager", "Zeroed page pools:\n");
+    dbgprintf("MemoryManager", "  Kernel: %u/%u pages, %u hits, %u misses\n", m_zeroed_kernel_pages.size(), m_zeroed_kernel_pages.capacity(), m_zeroed_kernel_pages.hits(), m_zeroed_kernel_pages.misses());
+    dbgprintf("MemoryManager", "  User: %u/%u pages, %u hits, %u misses\n", m_zeroed_user_pages.size(), m_zeroed_user_pages.capacity(), m_zeroed_user_pages.hits(), m_zeroed_user_pages.misses());
+
+    if (m_swap_space.ptr() != nullptr) {
+        dbgprintf("MemoryManager", "Swap: %u/%u pages in use\n", m_swap_space->used_slots(), m_swap_space->slot_count());
+    }
+    m_compressed_pages->dump_statistics();
+    PageMerger::the().dump_statistics();
+
+    dbgprintf("MemoryManager", "Physical Kernel Regions:\n");
+    for (size_t i = 0; i < m_kernel_physical_regions.size(); i++) {
+        m_kernel_physical_regions[i]->dump_statistics();
+    }
+
+    dbgprintf("MemoryManager", "Physical User Regions:\n");
+    for (size_t i = 0; i < m_user_physical_regions.size(); i++) {
+        m_user_physical_regions[i]->dump_statistics();
+    }
+}
+
+void MemoryManager::get_memory_statistics(meminfo& info) const
+{
+    for (size_t i = 0; i < m_kernel_physical_regions.size(); i++) {
+        info.kernel_pages_total += m_kernel_physical_regions[i]->total_pages();
+        info.kernel_pages_free += m_kernel_physical_regions[i]->total_pages() - m_kernel_physical_regions[i]->used_pages();
+    }
+
+    for (size_t i = 0; i < m_user_physical_regions.size(); i++) {
+        info.user_pages_total += m_user_physical_regions[i]->total_pages();
+        info.user_pages_free += m_user_physical_regions[i]->total_pages() - m_user_physical_regions[i]->used_pages();
+    }
+
+    // Pooled pages are only waiting to be handed out again. Kernel regions are the direct
+    // mapped ones, so that tells which kind of region a pooled page was taken from.
+    auto count_pooled_page = [&](PhysicalAddress page) {
+        if (is_direct_mapped(page)) {
+            info.kernel_pages_free++;
+        } else {
+            info.user_pages_free++;
         }
+    };
+
+    for (size_t i = 0; i < m_zeroed_kernel_pages.size(); i++) {
+        count_pooled_page(m_zeroed_kernel_pages[i]);
+    }
+    for (size_t i = 0; i < m_zeroed_user_pages.size(); i++) {
+        count_pooled_page(m_zeroed_user_pages[i]);
     }
 
-    ASSERT(page_result.is_ok());
-    // memset(page_result.value().ptr(), 0, Types::PageSize);
-    return page_result.value();
+    if (m_swap_space.ptr() != nullptr) {
+        info.swap_pages_total = m_swap_space->slot_count();
+        info.swap_pages_free = m_swap_space->slot_count() - m_swap_space->used_slots();
+    }
+    info.compressed_swap_pages = m_compressed_pages->stored_pages();
+    info.compressed_swap_bytes = m_compressed_pages->stored_bytes();
+    info.merged_pages_shared = PageMerger::the().pages_shared();
+    info.merged_pages_saved = PageMerger::the().pages_saved();
 }
 
-Result MemoryManager::free_physical_user_page(PhysicalAddress address)
+u32 MemoryManager::free_physical_page_count() const
 {
-    bool found_region = false;
+    u32 free_pages = 0;
+    for (size_t i = 0; i < m_kernel_physical_regions.size(); i++) {
+        free_pages += m_kernel_physical_regions[i]->total_pages() - m_kernel_physical_regions[i]->used_pages();
+    }
     for (size_t i = 0; i < m_user_physical_regions.size(); i++) {
-        auto region = m_user_physical_regions[i];
-        if (region->includes(address)) {
-            TRY(region->free_page(address));
-            found_region = true;
-            break;
+        free_pages += m_user_physical_regions[i]->total_pages() - m_user_physical_regions[i]->used_pages();
+    }
+    return free_pages;
+}
+
+Result MemoryManager::evict_user_page()
+{
+    if (!can_swap()) {
+        return Status::Failure;
+    }
+
+    // The first trip around clears every accessed bit, so any page that can be evicted at all
+    // is found before the hand has gone around twice
+    size_t pages_left = 0;
+    for (auto* region = m_user_virtual_regions.head(); region != nullptr; region = region->next()) {
+        pages_left += region->page_count();
+    }
+    pages_left *= 2;
+
+    // The regions belong to other processes that may run in between, so they are only looked at
+    // with nothing else running and left alone while their owner is rearranging them
+    VirtualRegion::PageOut page_out;
+    bool is_page_picked = false;
+
+    PM.enter_critical();
+    while (pages_left > 0 && !is_page_picked) {
+        if (m_clock_region == nullptr || m_clock_page >= m_clock_region->page_count()) {
+            m_clock_region = m_clock_region != nullptr ? m_clock_region->next() : nullptr;
+            if (m_clock_region == nullptr) {
+                m_clock_region = m_user_virtual_regions.head();
+            }
+            m_clock_page = 0;
+            continue;
+        }
+
+        auto* owner = m_clock_region->owner();
+        if (!m_clock_region->can_swap_out() || owner == nullptr || owner->is_dead() || owner->is_changing_memory()) {
+            pages_left -= min(pages_left, m_clock_region->page_count() - m_clock_page);
+            m_clock_page = m_clock_region->page_count();
+            continue;
+        }
+
+        pages_left--;
+        is_page_picked = m_clock_region->sweep_page(m_clock_page++, page_out);
+    }
+    PM.exit_critical();
+
+    if (!is_page_picked) {
+        return Status::Failure;
+    }
+
+    // Only the write runs with interrupts enabled, and it must not hold anyone else's critical
+    // section while the disk driver waits for its lock
+    ASSERT(!PM.is_in_critical());
+
+    Expected<u32> swap_entry = Result(Status::Failure);
+    auto mapping = temporary_map(page_out.physical_page);
+    if (mapping.is_ok()) {
+        swap_entry = swap_out_page(static_cast<const u8*>(mapping.value().ptr()));
+        temporary_unmap(mapping.value());
+    }
+
+    // The region may change again as soon as the page out is finished
+    PM.enter_critical();
+    if (swap_entry.is_ok()) {
+        dbgprintf_if(DEBUG_MEMORY_MANAGER, "MemoryManager", "Evicted page 0x%x to swap\n", page_out.region->lower().offset(page_out.page_index * kPageSize));
+    }
+    page_out.region->finish_page_out(page_out, swap_entry);
+    PM.exit_critical();
+
+    return swap_entry.is_ok() ? Result(Status::OK) : swap_entry.error();
+}
+
+void MemoryManager::enable_swap(UniquePtr<SwapSpace> swap_space)
+{
+    m_swap_space = move(swap_space);
+}
+
+void MemoryManager::set_compressed_pool_limit(size_t limit)
+{
+    m_compressed_pages->set_limit(limit);
+}
+
+bool MemoryManager::can_swap() const
+{
+    return !m_compressed_pages->is_full() || (m_swap_space.ptr() != nullptr && !m_swap_space->is_full());
+}
+
+Expected<u32> MemoryManager::swap_out_page(const u8* page)
+{
+    // Everything that uses the pool shares its scratch buffer, only disk transfers can be interrupted
+    PM.enter_critical();
+    auto handle = m_compressed_pages->store(page);
+    PM.exit_critical();
+    if (handle.is_ok()) {
+        return handle.value() | kCompressedSwapEntry;
+    }
+
+    if (m_swap_space.ptr() == nullptr) {
+        return handle.error();
+    }
+
+    u32 slot = TRY_TAKE(m_swap_space->allocate_slot());
+    auto result = m_swap_space->write_page(slot, page);
+    if (result.is_error()) {
+        m_swap_space->free_slot(slot);
+        return result;
+    }
+    return slot;
+}
+
+Result MemoryManager::swap_in_page(u32 swap_entry, u8* page)
+{
+    if (swap_entry & kCompressedSwapEntry) {
+        PM.enter_critical();
+        auto result = m_compressed_pages->load(swap_entry & ~kCompressedSwapEntry, page);
+        PM.exit_critical();
+        return result;
+    }
+    return m_swap_space->read_page(swap_entry, page);
+}
+
+Expected<u32> MemoryManager::duplicate_swap_entry(u32 swap_entry)
+{
+    if (swap_entry & kCompressedSwapEntry) {
+        PM.enter_critical();
+        auto handle = m_compressed_pages->duplicate(swap_entry & ~kCompressedSwapEntry);
+        PM.exit_critical();
+        if (handle.is_error()) {
+            return handle.error();
         }
+        return handle.value() | kCompressedSwapEntry;
+    }
+    return m_swap_space->duplicate_slot(swap_entry);
+}
+
+void MemoryManager::free_swap_entry(u32 swap_entry)
+{
+    if (swap_entry & kCompressedSwapEntry) {
+        PM.enter_critical();
+        m_compressed_pages->free(swap_entry & ~kCompressedSwapEntry);
+        PM.exit_critical();
+        return;
+    }
+    m_swap_space->free_slot(swap_entry);
+}
+
+PhysicalRegion* MemoryManager::find_physical_region(PhysicalAddress address)
+{
+    auto* frame = page_frame(address);
+    if (frame == nullptr || frame->region_index == PageFrame::kNoRegion) {
+        return nullptr;
     }
-    return found_region ? Status::OK : Status::Failure;
+
+    if (frame->region_index < m_kernel_physical_regions.size()) {
+        return m_kernel_physical_regions[frame->region_index].ptr();
+    }
+    return m_user_physical_regions[frame->region_index - m_kernel_physical_regions.size()].ptr();
 }
 
 UniquePtr<VirtualRegion> MemoryManager::allocate_kernel_region(size_t size)
@@ -250,7 +716,6 @@ UniquePtr<VirtualRegion> MemoryManager::allocate_kernel_dma_region(size_t size)
     auto virtual_region = VirtualRegion::create_kernel_dma_region(address_range.value(), VirtualRegion::Read | VirtualRegion::Write);
     dbgprintf_if(DEBUG_MEMORY_MANAGER, "MemoryManager", "Allocated Kernel DMA region from 0x%x to 0x%x\n", virtual_region->lower(), virtual_region->upper());
     virtual_region->map(*m_kernel_page_directory);
-    flush_tlb();
     return virtual_region;
 }
 
@@ -262,7 +727,6 @@ UniquePtr<VirtualRegion> MemoryManager::allocate_kernel_region_at(PhysicalAddres
     auto virtual_region = VirtualRegion::create_kernel_region_at(physical_address, address_range.value(), VirtualRegion::Read | VirtualRegion::Write | VirtualRegion::Execute);
     dbgprintf_if(DEBUG_MEMORY_MANAGER, "MemoryManager", "Allocated Kernel region from 0x%x to 0x%x\n", virtual_region->lower(), virtual_region->upper());
     virtual_region->map(*m_kernel_page_directory);
-    flush_tlb();
     return virtual_region;
 }
 
@@ -278,77 +742,204 @@ void MemoryManager::protected_map(PageDirectory& page_directory, VirtualAddress
 {
     ASSERT(virtual_address.is_page_aligned());
 
-    for (size_t i = 0; i < length; i += kPageSize) {
-        auto page_table_entry_address = virtual_address.offset(i);
-        auto& page_table_entry = get_page_table_entry(*m_kernel_page_directory, page_table_entry_address, true);
-        page_table_entry.set_physical_page_base(page_table_entry_address.get());
-        page_table_entry.set_user(false);
-        page_table_entry.set_present(false);
-        page_table_entry.set_read_write(false);
-    }
-    flush_tlb();
+    // Entries keep their identity address but stay non-present so any access faults
+    map_range(page_directory, virtual_address, virtual_address.get(), page_round_up(length) / kPageSize, 0);
 }
 
 void MemoryManager::identity_map(PageDirectory& page_directory, VirtualAddress virtual_address, size_t length)
 {
     ASSERT(virtual_address.is_page_aligned());
 
-    for (size_t i = 0; i < length; i += kPageSize) {
-        auto page_table_entry_address = virtual_address.offset(i);
-        auto& page_table_entry = get_page_table_entry(page_directory, page_table_entry_address, true);
-        page_table_entry.set_physical_page_base(page_table_entry_address.get());
+    map_range(page_directory, virtual_address, virtual_address.get(), page_round_up(length) / kPageSize, PageTableEntry::Present | PageTableEntry::ReadWrite);
+}
+
+void MemoryManager::map_range(PageDirectory& page_directory, VirtualAddress virtual_address, PhysicalAddress physical_address, size_t page_count, u32 flags)
+{
+    ASSERT(virtual_address.is_page_aligned() && physical_address.is_page_aligned());
+
+    bool is_user = flags & PageTableEntry::UserSupervisor;
+    if (virtual_address.get() >= kKernelVirtualBase) {
+        flags |= PageTableEntry::Global;
+    }
+
+    for_each_page_table(page_directory, virtual_address, page_count, true, is_user, [&](PageTableEntry* entries, VirtualAddress, size_t first_page, size_t count) {
+        u32 physical_page = physical_address.get() + first_page * kPageSize;
+        for (size_t i = 0; i < count; i++, physical_page += kPageSize) {
+            entries[i].set(physical_page, flags);
+        }
+    });
+
+    invalidate_range(virtual_address, page_count);
+}
+
+void MemoryManager::unmap_range(PageDirectory& page_directory, VirtualAddress virtual_address, size_t page_count)
+{
+    ASSERT(virtual_address.is_page_aligned());
+
+    for_each_page_table(page_directory, virtual_address, page_count, false, false, [&](PageTableEntry* entries, VirtualAddress, size_t, size_t count) {
+        if (entries == nullptr) {
+            return;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            entries[i].set(0, 0);
+        }
+    });
+
+    invalidate_range(virtual_address, page_count);
+}
+
+void MemoryManager::invalidate_range(VirtualAddress virtual_address, size_t page_count)
+{
+    if (page_count > kTlbFlushThresholdPages) {
+        if (virtual_address.get() >= kKernelVirtualBase) {
+            flush_global_tlb();
+        } else {
+            flush_tlb();
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < page_count; i++) {
+        invalidate_page(virtual_address.offset(i * kPageSize));
+    }
+}
+
+void MemoryManager::map_large_page(PageDirectory& page_directory, VirtualAddress virtual_address, PhysicalAddress physical_address, u32 flags)
+{
+    ASSERT(virtual_address.get() % kLargePageSize == 0 && physical_address.get() % kLargePageSize == 0);
+    ASSERT(virtual_address.get() < kKernelVirtualBase);
+
+    // A page table left behind by earlier small mappings of this range has nothing mapped anymore
+    u16 page_directory_index = PAGE_DIRECTORY_INDEX(virtual_address);
+    auto& page_directory_entry = page_directory.entries()[page_directory_index];
+    if (page_directory_entry.is_present() && !page_directory_entry.is_large_page()) {
+        MUST(free_physical_kernel_page(page_directory_entry.address().page_base()));
+    }
+
+    page_directory_entry = PageDirectoryEntry(physical_address.get() | (flags & 0xfff) | PageDirectoryEntry::LargePage);
+    invalidate_page(virtual_address);
+}
+
+void MemoryManager::unmap_large_page(PageDirectory& page_directory, VirtualAddress virtual_address)
+{
+    u16 page_directory_index = PAGE_DIRECTORY_INDEX(virtual_address);
+    auto& page_directory_entry = page_directory.entries()[page_directory_index];
+    ASSERT(!page_directory_entry.is_present() || page_directory_entry.is_large_page());
+
+    page_directory_entry = 0;
+    invalidate_page(virtual_address);
+}
+
+Expected<VirtualAddress> MemoryManager::temporary_map(PhysicalAddress physical_address)
+{
+    return temporary_map(&physical_address, 1);
+}
+
+Expected<VirtualAddress> MemoryManager::temporary_map(const PhysicalAddress* physical_pages, size_t count)
+{
+    if (count == 0 || count > kKernelTemporaryMapSlots) {
+        return Result(Status::Failure);
+    }
+
+    CPU::InterruptDisabler interrupt_disabler;
+
+    u32 slot_mask = (1u << count) - 1;
+    size_t first_slot = 0;
+    for (; first_slot + count <= kKernelTemporaryMapSlots; first_slot++) {
+        if ((m_temporary_map_slots & (slot_mask << first_slot)) == 0) {
+            break;
+        }
+    }
+
+    if (first_slot + count > kKernelTemporaryMapSlots) {
+        return Result(Status::Failure);
+    }
+
+    m_temporary_map_slots |= slot_mask << first_slot;
+
+    auto virtual_address = VirtualAddress(kKernelTemporaryMapBase + first_slot * kPageSize);
+    for (size_t i = 0; i < count; i++) {
+        auto& page_table_entry = m_temporary_map_entries[first_slot + i];
+        page_table_entry.set_physical_page_base(physical_pages[i]);
         page_table_entry.set_user(false);
+        page_table_entry.set_global(true);
         page_table_entry.set_present(true);
         page_table_entry.set_read_write(true);
+
+        // Unmapping leaves the old translation in the TLB, so it is dropped here instead
+        invalidate_page(virtual_address.offset(i * kPageSize));
     }
-    flush_tlb();
+
+    return virtual_address;
 }
 
-Expected<VirtualAddress> MemoryManager::temporary_map(PhysicalAddress physical_address)
+void MemoryManager::temporary_unmap(VirtualAddress virtual_address, size_t count)
 {
-    if (m_is_temporary_page_mapped) {
-        return Result(Status::Failure);
+    ASSERT(virtual_address.get() >= kKernelTemporaryMapBase && virtual_address.get() + count * kPageSize <= kKernelTemporaryMapBase + kKernelTemporaryMapLength);
+
+    CPU::InterruptDisabler interrupt_disabler;
+
+    size_t first_slot = (virtual_address.get() - kKernelTemporaryMapBase) / kPageSize;
+    for (size_t i = 0; i < count; i++) {
+        auto& page_table_entry = m_temporary_map_entries[first_slot + i];
+        page_table_entry.set_physical_page_base(0);
+        page_table_entry.set_present(false);
+        page_table_entry.set_read_write(false);
     }
 
-    auto& page_table_entry = get_page_table_entry(kernel_page_directory(), kKernelTemporaryMapBase, true);
-    page_table_entry.set_physical_page_base(physical_address);
-    page_table_entry.set_user(false);
-    page_table_entry.set_present(true);
-    page_table_entry.set_read_write(true);
-    invalidate_page(kKernelTemporaryMapBase);
-    m_is_temporary_page_mapped = true;
-    return VirtualAddress(kKernelTemporaryMapBase);
+    m_temporary_map_slots &= ~(((1u << count) - 1) << first_slot);
 }
 
-void MemoryManager::temporary_unmap()
+SharedPtr<PageDirectory> MemoryManager::create_user_page_directory()
 {
-    if (!m_is_temporary_page_mapped) {
-        return;
+    auto page_directory = PageDirectory::create_user_page_directory();
+    page_directory->set_base(allocate_physical_kernel_page());
+    copy_kernel_page_directory(*page_directory);
+    return page_directory;
+}
+
+void MemoryManager::free_user_page_directory(PageDirectory& page_directory)
+{
+    ASSERT(&page_directory != m_kernel_page_directory.ptr());
+
+    // Only the user half has page tables of its own, everything else points at the kernel's
+    auto* entries = page_directory.entries();
+    for (u32 i = kUserVirtualBase / kLargePageSize; i < kKernelVirtualBase / kLargePageSize; i++) {
+        if (!entries[i].is_present() || entries[i].is_large_page()) {
+            continue;
+        }
+
+        MUST(free_physical_kernel_page(entries[i].address().page_base()));
+        entries[i] = 0;
     }
 
-    auto& page_table_entry = get_page_table_entry(kernel_page_directory(), kKernelTemporaryMapBase, true);
-    page_table_entry.set_physical_page_base(0);
-    page_table_entry.set_user(false);
-    page_table_entry.set_present(false);
-    page_table_entry.set_read_write(false);
-    invalidate_page(kKernelTemporaryMapBase);
-    m_is_temporary_page_mapped = false;
+    MUST(free_physical_kernel_page(page_directory.base()));
+    page_directory.set_base(PhysicalAddress());
 }
 
 void MemoryManager::copy_kernel_page_directory(PageDirectory& page_directory)
 {
-    // page_directory.
+    // The identity map of the first 4 MiB and the whole higher half are shared by every address
+    // space. Kernel page tables never change after boot, so copying the entries once is enough.
+    auto* entries = page_directory.entries();
+    auto* kernel_entries = m_kernel_page_directory->entries();
+    u32 first_kernel_entry = kKernelVirtualBase / kLargePageSize;
+
+    entries[0].copy(kernel_entries[0]);
+    memcpy(&entries[first_kernel_entry], &kernel_entries[first_kernel_entry], (kPageTableEntryCount - first_kernel_entry) * sizeof(PageDirectoryEntry));
 }
 
-PageTableEntry& MemoryManager::get_page_table_entry(PageDirectory& page_directory, VirtualAddress virtual_address, bool is_user)
+PageTableEntry* MemoryManager::get_page_table(PageDirectory& page_directory, VirtualAddress virtual_address, bool is_user)
 {
     u16 page_directory_index = PAGE_DIRECTORY_INDEX(virtual_address);
-    u16 page_table_index = PAGE_TABLE_INDEX(virtual_address);
     PageDirectoryEntry& page_directory_entry = page_directory.entries()[page_directory_index];
 
     if (!page_directory_entry.is_present()) {
+        // A kernel page table created now would only show up in address spaces created after it
+        ASSERT(!m_kernel_page_tables_preallocated || virtual_address.get() < kKernelVirtualBase);
+
         auto page_table = allocate_physical_kernel_page();
-        memset(page_table.ptr(), 0, kPageSize);
 
         dbgprintf_if(DEBUG_MEMORY_MANAGER, "MemoryManager", "Allocated page table @ 0x%x\n", page_table);
 
@@ -358,7 +949,26 @@ PageTableEntry& MemoryManager::get_page_table_entry(PageDirectory& page_director
         page_directory_entry.set_read_write(true);
     }
 
-    return page_directory_entry.page_table_base()[page_table_index];
+    // The direct map has no page tables to hand out
+    ASSERT(!page_directory_entry.is_large_page());
+    return page_directory_entry.page_table_base();
+}
+
+PageTableEntry* MemoryManager::find_page_table(PageDirectory& page_directory, VirtualAddress virtual_address)
+{
+    u16 page_directory_index = PAGE_DIRECTORY_INDEX(virtual_address);
+    PageDirectoryEntry& page_directory_entry = page_directory.entries()[page_directory_index];
+
+    if (!page_directory_entry.is_present() || page_directory_entry.is_large_page()) {
+        return nullptr;
+    }
+    return page_directory_entry.page_table_base();
+}
+
+PageTableEntry& MemoryManager::get_page_table_entry(PageDirectory& page_directory, VirtualAddress virtual_address, bool is_user)
+{
+    u16 page_table_index = PAGE_TABLE_INDEX(virtual_address);
+    return get_page_table(page_directory, virtual_address, is_user)[page_table_index];
 }
 
 Result MemoryManager::remove_page_table_entry(PageDirectory& page_directory, VirtualAddress virtual_address)
@@ -371,6 +981,10 @@ Result MemoryManager::remove_page_table_entry(PageDirectory& page_directory, Vir
         return Status::OK;
     }
 
+    if (page_directory_entry.is_large_page()) {
+        return Status::Failure;
+    }
+
     PageTableEntry& page_table_entry = page_directory_entry.page_table_base()[page_table_index];
     page_table_entry.set_present(false);
     page_table_entry.set_read_write(false);
@@ -379,6 +993,29 @@ Result MemoryManager::remove_page_table_entry(PageDirectory& page_directory, Vir
     return Status::OK;
 }
 
+Result MemoryManager::handle_page_fault(const PageFault& fault)
+{
+    if (!ProcessManager::started() || fault.address().get() >= kKernelVirtualBase) {
+        return Status::Failure;
+    }
+
+    auto& process = PM.current_process();
+    if (process.is_kernel()) {
+        return Status::Failure;
+    }
+
+    auto* region = process.find_region(fault.address());
+    if (region == nullptr) {
+        dbgprintf("MemoryManager", "'%s' (%u) faulted on unmapped address 0x%x\n", process.name().data(), process.pid(), fault.address());
+        return Status::Failure;
+    }
+
+    process.begin_memory_change();
+    auto result = region->handle_fault(fault);
+    process.end_memory_change();
+    return result;
+}
+
 void MemoryManager::add_vm_object(VMObject& vm_object)
 {
     m_vm_objects.add_last(&vm_object);
@@ -389,6 +1026,16 @@ void MemoryManager::remove_vm_object(VMObject& vm_object)
     m_vm_objects.remove(&vm_object);
 }
 
+VMObject* MemoryManager::find_vm_object(const Inode& inode)
+{
+    for (VMObject* vm_object = m_vm_objects.head(); vm_object != nullptr; vm_object = vm_object->next()) {
+        if (vm_object->is_backing(inode)) {
+            return vm_object;
+        }
+    }
+    return nullptr;
+}
+
 void MemoryManager::add_virtual_region(VirtualRegion& virtual_region)
 {
     if (virtual_region.upper().get() >= kKernelVirtualBase) {
@@ -400,6 +1047,11 @@ void MemoryManager::add_virtual_region(VirtualRegion& virtual_region)
 
 void MemoryManager::remove_virtual_region(VirtualRegion& virtual_region)
 {
+    if (m_clock_region == &virtual_region) {
+        m_clock_region = virtual_region.next();
+        m_clock_page = 0;
+    }
+
     if (virtual_region.upper().get() >= kKernelVirtualBase) {
         m_kernel_virtual_regions.remove(&virtual_region);
     } else {
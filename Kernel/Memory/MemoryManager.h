@@ -7,33 +7,61 @@
 #pragma once
 
 #include <Kernel/Boot/multiboot.h>
+#include <Kernel/Memory/PageFault.h>
+#include <Kernel/Memory/CompressedPagePool.h>
 #include <Kernel/Memory/Paging.h>
 #include <Kernel/Memory/PhysicalRegion.h>
+#include <Kernel/Memory/SwapSpace.h>
 #include <Kernel/Memory/VMObject.h>
 #include <Kernel/Memory/VirtualRegion.h>
+#include <Kernel/Memory/ZeroedPagePool.h>
 #include <Universal/ArrayList.h>
+#include <Universal/Number.h>
 #include <Universal/Result.h>
 #include <Universal/Types.h>
 #include <Universal/UniquePtr.h>
 
 #define MM MemoryManager::the()
 
+struct meminfo;
+
 class MemoryManager final {
 public:
+    static constexpr size_t kZeroedKernelPagePoolSize = 16;
+    static constexpr size_t kZeroedUserPagePoolSize = 64;
+    // With swap enabled, user allocations start evicting pages once fewer than this are free,
+    // so the kernel can still allocate while user memory is over committed
+    static constexpr u32 kSwapLowWatermarkPages = 256;
+    // Default cap on the compressed bytes kept in memory, as a share of physical memory. The pool
+    // clamps it to its share of the kernel heap on larger machines.
+    static constexpr size_t kCompressedPoolPercent = 25;
+    // Set in swap entries that refer to the compressed pool rather than a swap slot
+    static constexpr u32 kCompressedSwapEntry = 1u << 31;
+
     static MemoryManager& the();
 
     static void init(u32* boot_page_directory, const multiboot_information_t*);
 
     MemoryManager();
 
+    static bool is_direct_mapped(PhysicalAddress address) { return address.get() < Memory::kKernelDirectMapMaxLength; }
+
     PageDirectory& kernel_page_directory() { return *m_kernel_page_directory; }
     const PageDirectory& kernel_page_directory() const { return *m_kernel_page_directory; }
 
     PhysicalAddress allocate_physical_kernel_page();
     PhysicalAddress allocate_physical_contiguous_kernel_pages(u32);
     Result free_physical_kernel_page(PhysicalAddress);
-    PhysicalAddress allocate_physical_user_page();
+    // Fail once nothing is left to evict, the caller decides whether that kills a process
+    Expected<PhysicalAddress> allocate_physical_user_page();
+    Expected<PhysicalAddress> allocate_zeroed_physical_user_page();
     Result free_physical_user_page(PhysicalAddress);
+    // A zeroed, pinned run of pages aligned to and as long as a large page
+    Expected<PhysicalAddress> allocate_physical_user_large_page();
+    Result share_physical_user_page(PhysicalAddress);
+    u16 physical_user_page_share_count(PhysicalAddress);
+
+    PageFrame* page_frame(PhysicalAddress);
 
     UniquePtr<VirtualRegion> allocate_kernel_region(size_t size);
     UniquePtr<VirtualRegion> allocate_kernel_dma_region(size_t size);
@@ -43,22 +71,76 @@ public:
     void protected_map(PageDirectory&, VirtualAddress, size_t);
     void identity_map(PageDirectory&, VirtualAddress, size_t);
 
+    // Maps page_count pages of contiguous physical memory, flags are PageTableEntry::Flags
+    void map_range(PageDirectory&, VirtualAddress, PhysicalAddress, size_t page_count, u32 flags);
+    void unmap_range(PageDirectory&, VirtualAddress, size_t page_count);
+    void invalidate_range(VirtualAddress, size_t page_count);
+
+    // Maps a single large page straight from the page directory, flags are PageDirectoryEntry::Flags
+    void map_large_page(PageDirectory&, VirtualAddress, PhysicalAddress, u32 flags);
+    void unmap_large_page(PageDirectory&, VirtualAddress);
+
+    // Calls callback(entries, virtual_address, first_page, count) once for every page table the
+    // range touches. entries points at the entry for virtual_address, or is null when the page
+    // table does not exist and create is false.
+    template<typename Callback>
+    void for_each_page_table(PageDirectory&, VirtualAddress, size_t page_count, bool create, bool is_user, Callback);
+
     Expected<VirtualAddress> temporary_map(PhysicalAddress);
-    void temporary_unmap();
+    Expected<VirtualAddress> temporary_map(const PhysicalAddress*, size_t count);
+    void temporary_unmap(VirtualAddress, size_t count = 1);
 
+    SharedPtr<PageDirectory> create_user_page_directory();
+    void free_user_page_directory(PageDirectory&);
     void copy_kernel_page_directory(PageDirectory&);
 
+    PageTableEntry* get_page_table(PageDirectory&, VirtualAddress, bool is_user);
+    PageTableEntry* find_page_table(PageDirectory&, VirtualAddress);
     PageTableEntry& get_page_table_entry(PageDirectory&, VirtualAddress, bool is_kernel);
     Result remove_page_table_entry(PageDirectory& page_directory, VirtualAddress virtual_address);
 
+    Result handle_page_fault(const PageFault&);
+
+    void refill_zeroed_page_pools();
+
+    void dump_physical_memory_statistics() const;
+    void get_memory_statistics(meminfo&) const;
+
     void add_vm_object(VMObject&);
     void remove_vm_object(VMObject&);
+    VMObject* find_vm_object(const Inode&);
 
     void add_virtual_region(VirtualRegion&);
     void remove_virtual_region(VirtualRegion&);
 
+    // Once enabled, running out of user pages evicts cold anonymous pages instead of failing
+    void enable_swap(UniquePtr<SwapSpace>);
+    void set_compressed_pool_limit(size_t);
+
+    // Evicted pages are kept compressed in memory while the pool has room and on the swap
+    // partition otherwise. Either way the region gets back an entry that names the copy.
+    // Disk transfers let other processes run, so none of these are called in a critical section.
+    bool can_swap() const;
+    Expected<u32> swap_out_page(const u8* page);
+    Result swap_in_page(u32 swap_entry, u8* page);
+    // Gives the copy its own entry, used when a process with swapped out pages forks
+    Expected<u32> duplicate_swap_entry(u32 swap_entry);
+    void free_swap_entry(u32 swap_entry);
+
 private:
     void internal_init(u32* boot_page_directory, const multiboot_information_t*);
+    void direct_map(u32 length);
+    void create_page_frame_database(u32 physical_memory_end);
+    void preallocate_kernel_page_tables();
+
+    static Expected<PhysicalAddress> allocate_physical_page_from(ArrayList<SharedPtr<PhysicalRegion>>&);
+
+    PhysicalRegion* find_physical_region(PhysicalAddress);
+
+    Result zero_physical_page(PhysicalAddress);
+
+    u32 free_physical_page_count() const;
+    Result evict_user_page();
 
     SharedPtr<PageDirectory> m_kernel_page_directory;
 
@@ -70,5 +152,39 @@ private:
 
     LinkedList<VMObject> m_vm_objects;
 
-    bool m_is_temporary_page_mapped { false };
+    // Indexed by page frame number, covering every frame up to the end of RAM
+    PageFrame* m_page_frames { nullptr };
+    u32 m_page_frame_count { 0 };
+
+    ZeroedPagePool<kZeroedKernelPagePoolSize> m_zeroed_kernel_pages;
+    ZeroedPagePool<kZeroedUserPagePoolSize> m_zeroed_user_pages;
+
+    // One bit per temporary mapping slot that is in use, and the page table entry of the first slot
+    u32 m_temporary_map_slots { 0 };
+    PageTableEntry* m_temporary_map_entries { nullptr };
+
+    UniquePtr<SwapSpace> m_swap_space;
+    UniquePtr<CompressedPagePool> m_compressed_pages;
+    // The CLOCK hand, the next page looked at when a page has to be evicted
+    VirtualRegion* m_clock_region { nullptr };
+    size_t m_clock_page { 0 };
+
+    // Set once every kernel page table exists, after which the kernel half of the directory never changes
+    bool m_kernel_page_tables_preallocated { false };
 };
+
+template<typename Callback>
+inline void MemoryManager::for_each_page_table(PageDirectory& page_directory, VirtualAddress virtual_address, size_t page_count, bool create, bool is_user, Callback callback)
+{
+    size_t page = 0;
+    while (page < page_count) {
+        auto address = virtual_address.offset(page * Memory::kPageSize);
+        u16 page_table_index = PAGE_TABLE_INDEX(address);
+        size_t count = min(page_count - page, Memory::kPageTableEntryCount - page_table_index);
+
+        auto* page_table = create ? get_page_table(page_directory, address, is_user) : find_page_table(page_directory, address);
+        callback(page_table != nullptr ? &page_table[page_table_index] : nullptr, address, page, count);
+
+        page += count;
+    }
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2025, Jason Long <jasonlongball@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <Kernel/Memory/Address.h>
+#include <Universal/Types.h>
+
+class PageFault {
+public:
+    enum Flags {
+        ProtectionViolation = 1 << 0,
+        Write = 1 << 1,
+        User = 1 << 2,
+    };
+
+    PageFault(u32 error_code, VirtualAddress address)
+        : m_error_code(error_code)
+        , m_address(address)
+    {
+    }
+
+    bool is_not_present() const { return !(m_error_code & ProtectionViolation); }
+    bool is_protection_violation() const { return m_error_code & ProtectionViolation; }
+    bool is_write() const { return m_error_code & Write; }
+    bool is_read() const { return !is_write(); }
+    bool is_user() const { return m_error_code & User; }
+
+    u32 error_code() const { return m_error_code; }
+    VirtualAddress address() const { return m_address; }
+
+private:
+    u32 m_error_code { 0 };
+    VirtualAddress m_address;
+};
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2025, Jason Long <jasonlongball@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <Universal/Types.h>
+
+// Describes one physical page. The MemoryManager keeps one for every page frame of RAM in an
+// array indexed by page frame number, so finding the state of a frame never needs a search.
+struct PageFrame {
+    enum Flags : u8 {
+        Zeroed = 1 << 0,
+        Dirty = 1 << 1,
+        Pinned = 1 << 2,
+        Kernel = 1 << 3,
+        PageCache = 1 << 4,
+        // Kept read only by every mapping so that identical pages can share it
+        Merged = 1 << 5,
+    };
+
+    static constexpr u8 kNoRegion = 0xff;
+    static constexpr u8 kNotFreeBlock = 0xff;
+
+    bool is_free() const { return ref_count == 0; }
+
+    bool has_flag(Flags flag) const { return flags & flag; }
+    void set_flag(Flags flag, bool set)
+    {
+        if (set) {
+            flags |= flag;
+        } else {
+            flags &= ~flag;
+        }
+    }
+
+    // Owners of the frame, a frame is free when this drops to zero
+    u16 ref_count { 0 };
+    // User page table entries that currently map the frame
+    u16 map_count { 0 };
+    u8 flags { 0 };
+    // Index of the PhysicalRegion the frame is allocated from
+    u8 region_index { kNoRegion };
+    // Order of the free buddy block starting at this frame, kNotFreeBlock for every other frame
+    u8 block_order { kNotFreeBlock };
+    // Free list links of that block, as page indices within the region
+    u32 next_free_block { 0 };
+    u32 previous_free_block { 0 };
+};
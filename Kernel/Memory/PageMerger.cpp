@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2025, Jason Long <jasonlongball@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <Kernel/Devices/PIT.h>
+#include <Kernel/Memory/MemoryManager.h>
+#include <Kernel/Memory/PageMerger.h>
+#include <Kernel/Process/ProcessManager.h>
+#include <Universal/Logger.h>
+
+#define DEBUG_PAGE_MERGER 0
+
+using namespace Memory;
+
+static constexpr size_t kPageWords = kPageSize / sizeof(u32);
+
+static bool is_same_page(const u8* a, const u8* b)
+{
+    auto* a_words = reinterpret_cast<const u32*>(a);
+    auto* b_words = reinterpret_cast<const u32*>(b);
+    for (size_t i = 0; i < kPageWords; i++) {
+        if (a_words[i] != b_words[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+PageMerger& PageMerger::the()
+{
+    static PageMerger s_the;
+    return s_the;
+}
+
+void PageMerger::run()
+{
+    dbgprintln("PageMerger", "Starting the page merger");
+
+    u32 last_batch = PIT::milliseconds_since_boot();
+    while (true) {
+        if (PIT::milliseconds_since_boot() - last_batch < kBatchIntervalMilliseconds) {
+            PM.yield();
+            continue;
+        }
+
+        last_batch = PIT::milliseconds_since_boot();
+        scan_batch();
+    }
+}
+
+void PageMerger::scan_batch()
+{
+    // Nothing else runs during a batch, so the process and its regions stay where they are
+    PM.enter_critical();
+
+    size_t pages_left = kPagesPerBatch;
+    while (pages_left > 0) {
+        auto* process = PM.find_user_process_from(m_pid);
+        if (process == nullptr) {
+            finish_scan();
+            break;
+        }
+
+        if (process->pid() != m_pid) {
+            m_pid = process->pid();
+            m_address = VirtualAddress();
+        }
+
+        auto* region = process->is_changing_memory() ? nullptr : process->find_region_from(m_address);
+        if (region == nullptr) {
+            m_pid++;
+            m_address = VirtualAddress();
+            continue;
+        }
+
+        if (!region->can_merge()) {
+            m_address = region->upper();
+            pages_left--;
+            continue;
+        }
+
+        size_t page_index = m_address > region->lower() ? (m_address.get() - region->lower().get()) / kPageSize : 0;
+        for (; page_index < region->page_count() && pages_left > 0; page_index++, pages_left--) {
+            if (region->merge_page(page_index)) {
+                m_merges++;
+            }
+        }
+        m_address = region->lower().offset(page_index * kPageSize);
+    }
+
+    PM.exit_critical();
+}
+
+void PageMerger::finish_scan()
+{
+    m_pid = 0;
+    m_address = VirtualAddress();
+    m_full_scans++;
+
+    // Frames lose the flag once their last user writes to them or lets go of them
+    m_pages_shared = 0;
+    m_pages_saved = 0;
+    for (auto* node = m_merged_pages.first(); node != nullptr;) {
+        auto* next = RedBlackTree<u32, PhysicalAddress>::next(node);
+        auto* frame = MM.page_frame(node->value());
+        if (!frame->has_flag(PageFrame::Merged)) {
+            m_merged_pages.remove(node);
+        } else if (frame->ref_count > 1) {
+            m_pages_shared++;
+            m_pages_saved += frame->ref_count - 1;
+        }
+        node = next;
+    }
+
+    dbgprintf_if(DEBUG_PAGE_MERGER, "PageMerger", "Scan %u done, %u pages shared, %u saved\n", m_full_scans, m_pages_shared, m_pages_saved);
+}
+
+Expected<PhysicalAddress> PageMerger::find_or_add(PhysicalAddress page, const u8* contents)
+{
+    u32 hash = hash_page(contents);
+
+    auto* node = m_merged_pages.find(hash);
+    if (node != nullptr) {
+        auto merged_page = node->value();
+        auto* frame = MM.page_frame(merged_page);
+
+        // A frame that lost the flag may have been reused for anything, a flagged one is
+        // compared in full since different contents can hash the same
+        if (frame->has_flag(PageFrame::Merged)) {
+            if (frame->ref_count == UINT16_MAX) {
+                return Result(Status::Failure);
+            }
+
+            auto mapping = TRY_TAKE(MM.temporary_map(merged_page));
+            bool is_duplicate = is_same_page(mapping.ptr(), contents);
+            MM.temporary_unmap(mapping);
+            if (!is_duplicate) {
+                return Result(Status::Failure);
+            }
+            return merged_page;
+        }
+
+        m_merged_pages.remove(node);
+    }
+
+    m_merged_pages.insert(hash, page);
+    MM.page_frame(page)->set_flag(PageFrame::Merged, true);
+    return page;
+}
+
+u32 PageMerger::hash_page(const u8* contents)
+{
+    // FNV-1a over whole words, the pages are compared in full before they are merged anyway
+    auto* words = reinterpret_cast<const u32*>(contents);
+    u32 hash = 2166136261u;
+    for (size_t i = 0; i < kPageWords; i++) {
+        hash = (hash ^ words[i]) * 16777619u;
+    }
+    return hash;
+}
+
+void PageMerger::dump_statistics() const
+{
+    dbgprintf("PageMerger", "%u merged frames, %u shared saving %u pages, %u merges in %u scans\n", m_merged_pages.size(), m_pages_shared, m_pages_saved, m_merges, m_full_scans);
+}
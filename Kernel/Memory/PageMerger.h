@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2025, Jason Long <jasonlongball@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <Kernel/Memory/Address.h>
+#include <Kernel/POSIX.h>
+#include <Universal/Expected.h>
+#include <Universal/RedBlackTree.h>
+#include <Universal/Types.h>
+
+// A kernel process that walks the private anonymous pages of every user process and maps
+// identical ones to a single frame. Merged frames are read only everywhere, so the first write
+// through any mapping copies the page back out like any other copy-on-write fault.
+class PageMerger {
+public:
+    // Pages looked at in one go with interrupts disabled, and how often that happens
+    static constexpr size_t kPagesPerBatch = 32;
+    static constexpr u32 kBatchIntervalMilliseconds = 10;
+
+    static PageMerger& the();
+    static void start() { the().run(); }
+
+    // The frame a page with these contents should be mapped to, either an identical merged
+    // frame or the page itself when it becomes the one later pages are merged into
+    Expected<PhysicalAddress> find_or_add(PhysicalAddress, const u8* contents);
+
+    // As of the last full scan, merged frames with more than one user and the frames they saved
+    size_t pages_shared() const { return m_pages_shared; }
+    size_t pages_saved() const { return m_pages_saved; }
+
+    void dump_statistics() const;
+
+private:
+    void run();
+    void scan_batch();
+    void finish_scan();
+
+    static u32 hash_page(const u8*);
+
+    // Merged frames by the hash of their contents
+    RedBlackTree<u32, PhysicalAddress> m_merged_pages;
+
+    // Where the scan continues, the next page at or above the address in the process
+    pid_t m_pid { 0 };
+    VirtualAddress m_address;
+
+    size_t m_full_scans { 0 };
+    size_t m_merges { 0 };
+    size_t m_pages_shared { 0 };
+    size_t m_pages_saved { 0 };
+};
@@ -21,6 +21,9 @@ public:
         Present = 1 << 0,
         ReadWrite = 1 << 1,
         UserSupervisor = 1 << 2,
+        Accessed = 1 << 5,
+        Dirty = 1 << 6,
+        Global = 1 << 8,
     };
 
     PageTableEntry() { }
@@ -37,6 +40,9 @@ public:
         m_address = m_address | (address & 0xfffff000);
     }
 
+    // Replaces the whole entry at once, flags are a combination of Flags
+    void set(u32 physical_page_base, u32 flags) { m_address.set((physical_page_base & 0xfffff000) | (flags & 0xfff)); }
+
     const VirtualAddress address() const { return m_address; }
     VirtualAddress address() { return m_address; }
 
@@ -49,6 +55,17 @@ public:
     bool is_user() const { return m_address & UserSupervisor; }
     void set_user(bool set) { set_bit(UserSupervisor, set); }
 
+    // Set by the CPU whenever the page is read or written through this entry
+    bool is_accessed() const { return m_address & Accessed; }
+    void set_accessed(bool set) { set_bit(Accessed, set); }
+
+    // Set by the CPU whenever the page is written through this entry
+    bool is_dirty() const { return m_address & Dirty; }
+    void set_dirty(bool set) { set_bit(Dirty, set); }
+
+    bool is_global() const { return m_address & Global; }
+    void set_global(bool set) { set_bit(Global, set); }
+
 private:
     void set_bit(u32 bit, bool value)
     {
@@ -68,6 +85,8 @@ public:
         Present = 1 << 0,
         ReadWrite = 1 << 1,
         UserSupervisor = 1 << 2,
+        LargePage = 1 << 7,
+        Global = 1 << 8,
     };
 
     PageDirectoryEntry() { }
@@ -77,7 +96,7 @@ public:
     {
     }
 
-    PageTableEntry* page_table_base() { return reinterpret_cast<PageTableEntry*>(m_address.get() & 0xfffff000); }
+    PageTableEntry* page_table_base() { return reinterpret_cast<PageTableEntry*>(Memory::physical_to_virtual(m_address.get() & 0xfffff000)); }
     void set_page_table_base(u32 address)
     {
         m_address = m_address & 0xfff;
@@ -98,6 +117,18 @@ public:
     bool is_user() const { return m_address & UserSupervisor; }
     void set_user(bool set) { set_bit(UserSupervisor, set); }
 
+    bool is_large_page() const { return m_address & LargePage; }
+    void set_large_page(bool set) { set_bit(LargePage, set); }
+
+    // Only meaningful on large pages, page table entries carry their own flag
+    bool is_global() const { return m_address & Global; }
+    void set_global(bool set) { set_bit(Global, set); }
+    void set_large_page_base(u32 address)
+    {
+        m_address = m_address & 0xfff;
+        m_address = m_address | (address & 0xffc00000);
+    }
+
 private:
     void set_bit(u32 bit, bool value)
     {
@@ -126,7 +157,7 @@ public:
     void set_base(PhysicalAddress base) { m_directory_page_base = base; }
     PhysicalAddress base() const { return m_directory_page_base; }
 
-    PageDirectoryEntry* entries() { return reinterpret_cast<PageDirectoryEntry*>(m_directory_page_base.get()); }
+    PageDirectoryEntry* entries() { return reinterpret_cast<PageDirectoryEntry*>(m_directory_page_base.ptr()); }
 
     AddressAllocator& address_allocator() { return m_address_allocator; }
 
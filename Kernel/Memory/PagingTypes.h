@@ -11,15 +11,29 @@
 namespace Memory {
 
 static constexpr u16 kPageSize = 4096;
+static constexpr size_t kPageTableEntryCount = 1024;
+
+// Invalidating more pages than this one at a time costs more than reloading CR3
+static constexpr size_t kTlbFlushThresholdPages = 32;
 
 static constexpr u32 kKernelVirtualBase = 0xC0000000;
 static constexpr u32 kKernelPhysicalBase = 0x00100000;
 static constexpr size_t kKernelImageMaxLength = 3 * MB;
-static constexpr size_t kKernelTemporaryMapLength = kPageSize;
-static constexpr u32 kKernelTemporaryMapBase = kKernelVirtualBase + kKernelImageMaxLength;
+static constexpr size_t kLargePageSize = 4 * MB;
+
+// Physical memory below this is mapped linearly at kKernelVirtualBase with large pages
+static constexpr size_t kKernelDirectMapMaxLength = 768 * MB;
+
+static constexpr size_t kKernelTemporaryMapSlots = 16;
+static constexpr size_t kKernelTemporaryMapLength = kKernelTemporaryMapSlots * kPageSize;
+static constexpr u32 kKernelTemporaryMapBase = kKernelVirtualBase + kKernelDirectMapMaxLength;
+
+// The slots must share one page table so their entries are contiguous
+static_assert((kKernelTemporaryMapBase >> 22) == ((kKernelTemporaryMapBase + kKernelTemporaryMapLength - 1) >> 22));
 
-static constexpr u32 kKernelFreePagesVirtualBase = kKernelVirtualBase + kKernelImageMaxLength + kKernelTemporaryMapLength;
-static constexpr size_t kKernelFreePagesLength = (1 * GB) - kKernelImageMaxLength - kKernelTemporaryMapLength;
+static constexpr u32 kKernelFreePagesVirtualBase = kKernelTemporaryMapBase + kKernelTemporaryMapLength;
+// Stops one large page short of the top of the address space so region bounds never wrap
+static constexpr size_t kKernelFreePagesLength = (1 * GB) - kKernelDirectMapMaxLength - kKernelTemporaryMapLength - kLargePageSize;
 
 static constexpr u32 kUserVirtualBase = 0x01000000;
 static constexpr size_t kUserVirtualLength = kKernelVirtualBase - kUserVirtualBase;
@@ -53,10 +67,62 @@ static constexpr inline u32 virtual_to_physical(u32 virtual_address)
     return virtual_address - kKernelVirtualBase;
 }
 
+// Global entries survive this, see flush_global_tlb()
 static inline void flush_tlb()
 {
     asm volatile("mov eax, cr3; \
-                  mov cr3, eax");
+                  mov cr3, eax"
+                 :
+                 :
+                 : "eax");
+}
+
+// Toggling CR4.PGE drops every translation, global ones included
+static inline void flush_global_tlb()
+{
+    asm volatile("mov eax, cr4; \
+                  xor eax, 0x80; \
+                  mov cr4, eax; \
+                  xor eax, 0x80; \
+                  mov cr4, eax"
+                 :
+                 :
+                 : "eax");
+}
+
+// Make the CPU honor read-only pages in ring 0 so kernel writes to
+// copy-on-write user memory fault just like user writes do
+static inline void enable_write_protect()
+{
+    asm volatile("mov eax, cr0; \
+                  or eax, 0x10000; \
+                  mov cr0, eax"
+                 :
+                 :
+                 : "eax");
+}
+
+// Allow page directory entries to map 4 MiB pages directly
+static inline void enable_page_size_extension()
+{
+    asm volatile("mov eax, cr4; \
+                  or eax, 0x10; \
+                  mov cr4, eax"
+                 :
+                 :
+                 : "eax");
+}
+
+// Keep translations marked global in the TLB across CR3 reloads. Every address
+// space shares the kernel half, so its entries never need to be dropped on a switch.
+static inline void enable_global_pages()
+{
+    asm volatile("mov eax, cr4; \
+                  or eax, 0x80; \
+                  mov cr4, eax"
+                 :
+                 :
+                 : "eax");
 }
 
 static inline void invalidate_page(u32 address)
@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2025, Jason Long <jasonlongball@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <Kernel/Memory/PhysicalExtentList.h>
+#include <Universal/Assert.h>
+
+size_t PhysicalExtentList::extent_count() const
+{
+    if (m_pages == nullptr) {
+        return m_extents.size();
+    }
+
+    size_t count = 0;
+    for_each_extent([&](const PhysicalExtent&) {
+        count++;
+    });
+    return count;
+}
+
+PhysicalAddress PhysicalExtentList::page(size_t page_index) const
+{
+    if (m_pages != nullptr) {
+        return page_index < m_page_count ? m_pages[page_index] : PhysicalAddress();
+    }
+
+    auto* node = find_extent(page_index);
+    if (node == nullptr) {
+        return PhysicalAddress();
+    }
+    return node->value().page(page_index);
+}
+
+void PhysicalExtentList::set_page(size_t page_index, PhysicalAddress physical_page)
+{
+    if (physical_page.is_null()) {
+        clear_pages(page_index, 1);
+        return;
+    }
+
+    set_pages(page_index, physical_page, 1);
+}
+
+void PhysicalExtentList::set_pages(size_t first_page, PhysicalAddress base, size_t count)
+{
+    ASSERT(first_page + count <= m_page_count);
+    ASSERT(base.is_page_aligned() && !base.is_null());
+
+    if (count == 0) {
+        return;
+    }
+
+    if (m_pages != nullptr) {
+        for (size_t i = 0; i < count; i++) {
+            m_pages[first_page + i] = base.offset(i * Memory::kPageSize);
+        }
+        return;
+    }
+
+    remove_pages(first_page, count);
+    merge_with_neighbours(m_extents.insert(first_page, { first_page, base, count }));
+    flatten_if_sparse();
+}
+
+void PhysicalExtentList::clear_pages(size_t first_page, size_t count)
+{
+    ASSERT(first_page + count <= m_page_count);
+    remove_pages(first_page, count);
+    flatten_if_sparse();
+}
+
+void PhysicalExtentList::resize(size_t page_count)
+{
+    if (page_count < m_page_count) {
+        remove_pages(page_count, m_page_count - page_count);
+    }
+
+    if (m_pages != nullptr) {
+        auto* pages = new PhysicalAddress[page_count]();
+        for (size_t i = 0; i < page_count && i < m_page_count; i++) {
+            pages[i] = m_pages[i];
+        }
+        delete[] m_pages;
+        m_pages = pages;
+    }
+
+    m_page_count = page_count;
+}
+
+PhysicalExtentList::ExtentTree::Node* PhysicalExtentList::find_extent(size_t page_index) const
+{
+    auto* node = m_extents.find_largest_not_above(page_index);
+    if (node == nullptr || node->value().end_page() <= page_index) {
+        return nullptr;
+    }
+    return node;
+}
+
+void PhysicalExtentList::remove_pages(size_t first_page, size_t count)
+{
+    if (m_pages != nullptr) {
+        for (size_t i = 0; i < count; i++) {
+            m_pages[first_page + i] = PhysicalAddress();
+        }
+        return;
+    }
+
+    size_t end_page = first_page + count;
+
+    // Only the extent starting at or before first_page can reach into the range from below
+    auto* node = m_extents.find_largest_not_above(first_page);
+    if (node == nullptr) {
+        node = m_extents.first();
+    } else if (node->value().end_page() <= first_page) {
+        node = ExtentTree::next(node);
+    }
+
+    while (node != nullptr && node->key() < end_page) {
+        auto extent = node->value();
+        auto* next = ExtentTree::next(node);
+
+        if (extent.first_page < first_page) {
+            node->value().count = first_page - extent.first_page;
+        } else {
+            m_extents.remove(node);
+        }
+
+        // The tail of an extent past the removed pages is keyed by its new first page
+        if (extent.end_page() > end_page) {
+            m_extents.insert(end_page, { end_page, extent.page(end_page), extent.end_page() - end_page });
+            return;
+        }
+
+        node = next;
+    }
+}
+
+void PhysicalExtentList::merge_with_neighbours(ExtentTree::Node* node)
+{
+    auto is_continued_by = [](const PhysicalExtent& extent, const PhysicalExtent& next) {
+        return extent.end_page() == next.first_page && extent.page(next.first_page).get() == next.base.get();
+    };
+
+    auto* next = ExtentTree::next(node);
+    if (next != nullptr && is_continued_by(node->value(), next->value())) {
+        node->value().count += next->value().count;
+        m_extents.remove(next);
+    }
+
+    auto* previous = ExtentTree::previous(node);
+    if (previous != nullptr && is_continued_by(previous->value(), node->value())) {
+        previous->value().count += node->value().count;
+        m_extents.remove(node);
+    }
+}
+
+void PhysicalExtentList::flatten_if_sparse()
+{
+    if (m_pages != nullptr || m_extents.size() * sizeof(ExtentTree::Node) <= m_page_count * sizeof(PhysicalAddress)) {
+        return;
+    }
+
+    auto* pages = new PhysicalAddress[m_page_count]();
+    for_each_extent([&](const PhysicalExtent& extent) {
+        for (size_t i = 0; i < extent.count; i++) {
+            pages[extent.first_page + i] = extent.page(extent.first_page + i);
+        }
+    });
+
+    m_extents.clear();
+    m_pages = pages;
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2025, Jason Long <jasonlongball@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <Kernel/Memory/Address.h>
+#include <Universal/RedBlackTree.h>
+#include <Universal/Types.h>
+
+// A run of pages that are contiguous both virtually and physically
+struct PhysicalExtent {
+    size_t first_page;
+    PhysicalAddress base;
+    size_t count;
+
+    size_t end_page() const { return first_page + count; }
+    PhysicalAddress page(size_t page_index) const { return base.offset((page_index - first_page) * Memory::kPageSize); }
+};
+
+// The physical pages backing a range of virtual pages, stored as non-overlapping extents
+// keyed by their first page. Pages that are not covered by an extent are not backed.
+// Once the extents would take more memory than one address per page, the list falls
+// back to a flat array of pages and stays that way.
+class PhysicalExtentList {
+public:
+    PhysicalExtentList(size_t page_count)
+        : m_page_count(page_count)
+    {
+    }
+
+    ~PhysicalExtentList() { delete[] m_pages; }
+
+    PhysicalExtentList(const PhysicalExtentList&) = delete;
+    PhysicalExtentList& operator=(const PhysicalExtentList&) = delete;
+
+    size_t page_count() const { return m_page_count; }
+    size_t extent_count() const;
+
+    // Returns a null address for pages that are not backed
+    PhysicalAddress page(size_t page_index) const;
+    bool is_backed(size_t page_index) const { return !page(page_index).is_null(); }
+
+    // Backs page_index with the given page, or leaves it unbacked when the address is null
+    void set_page(size_t page_index, PhysicalAddress);
+
+    // Backs count pages starting at first_page with contiguous physical memory
+    void set_pages(size_t first_page, PhysicalAddress, size_t count);
+
+    // Leaves count pages starting at first_page unbacked
+    void clear_pages(size_t first_page, size_t count);
+
+    // Pages cut off by shrinking are left unbacked, new pages start out unbacked
+    void resize(size_t page_count);
+
+    template<typename Callback>
+    void for_each_extent(Callback callback) const
+    {
+        if (m_pages == nullptr) {
+            for (auto* node = m_extents.first(); node != nullptr; node = ExtentTree::next(node)) {
+                callback(static_cast<const PhysicalExtent&>(node->value()));
+            }
+            return;
+        }
+
+        // Flat pages are handed out as the same maximal runs the extents would hold
+        size_t page_index = 0;
+        while (page_index < m_page_count) {
+            if (m_pages[page_index].is_null()) {
+                page_index++;
+                continue;
+            }
+
+            PhysicalExtent extent { page_index, m_pages[page_index], 1 };
+            while (extent.end_page() < m_page_count && m_pages[extent.end_page()].get() == extent.page(extent.end_page()).get()) {
+                extent.count++;
+            }
+            page_index = extent.end_page();
+            callback(static_cast<const PhysicalExtent&>(extent));
+        }
+    }
+
+private:
+    using ExtentTree = RedBlackTree<size_t, PhysicalExtent>;
+
+    // The extent holding page_index, or null when the page is not backed
+    ExtentTree::Node* find_extent(size_t page_index) const;
+    void remove_pages(size_t first_page, size_t count);
+    void merge_with_neighbours(ExtentTree::Node*);
+    void flatten_if_sparse();
+
+    ExtentTree m_extents;
+    PhysicalAddress* m_pages { nullptr };
+    size_t m_page_count { 0 };
+};
@@ -6,8 +6,9 @@
 
 #include <Kernel/Memory/PagingTypes.h>
 #include <Kernel/Memory/PhysicalRegion.h>
-#include <Kernel/kmalloc.h>
+#include <Kernel/POSIX.h>
 #include <Universal/Logger.h>
+#include <Universal/Stdlib.h>
 
 #define DEBUG_PHYSICAL_REGION 0
 
@@ -21,7 +22,6 @@ SharedPtr<PhysicalRegion> PhysicalRegion::create(PhysicalAddress lower, Physical
 PhysicalRegion::PhysicalRegion(PhysicalAddress lower, PhysicalAddress upper)
     : m_lower(lower)
     , m_upper(upper)
-    , m_bitmap(Bitmap::create())
 {
 }
 
@@ -35,60 +35,115 @@ void PhysicalRegion::expand(PhysicalAddress lower, PhysicalAddress upper)
     m_upper = upper;
 }
 
-u32 PhysicalRegion::commit()
+u32 PhysicalRegion::commit(PageFrame* frames, u8 region_index)
 {
-    m_total_pages = (m_upper - m_lower) / Memory::kPageSize;
-    u8* bitmap_address = static_cast<u8*>(kcalloc(m_total_pages / 8));
-    m_bitmap = Bitmap::wrap(bitmap_address, m_total_pages);
+    m_total_pages = page_count();
+
+    m_frames = frames;
+    for (u32 i = 0; i < m_total_pages; i++) {
+        m_frames[i].region_index = region_index;
+        m_frames[i].block_order = PageFrame::kNotFreeBlock;
+    }
+
+    for (u8 order = 0; order <= kMaxOrder; order++) {
+        m_free_lists[order] = kNoPage;
+    }
+
+    // Carve the region into the largest naturally aligned blocks that fit
+    u32 page_index = 0;
+    while (page_index < m_total_pages) {
+        u8 order = kMaxOrder;
+        while (order > 0 && ((page_index & ((1u << order) - 1)) != 0 || page_index + (1u << order) > m_total_pages)) {
+            order--;
+        }
+
+        add_free_block(page_index, order);
+        page_index += 1u << order;
+    }
 
     return m_total_pages;
 }
 
 Expected<PhysicalAddress> PhysicalRegion::allocate_contiguous_pages(u32 number_of_pages)
 {
-    auto contiguous_pages = find_contiguous_pages(number_of_pages);
-    if (contiguous_pages.is_error()) {
-        return contiguous_pages.error();
+    if (number_of_pages == 0) {
+        return Result(Status::Failure);
+    }
+
+    u8 order = 0;
+    while ((1u << order) < number_of_pages) {
+        order++;
+    }
+
+    if (order > kMaxOrder) {
+        return Result(Status::Failure);
     }
 
-    u32 start_page = contiguous_pages.value();
-    u32 current_page = start_page;
+    u32 start_page = TRY_TAKE(allocate_block(order));
     for (u32 i = 0; i < number_of_pages; i++) {
-        allocate_page_at(current_page++);
+        allocate_page_at(start_page + i);
+    }
+
+    // Hand back the tail of the block that was not asked for
+    for (u32 i = number_of_pages; i < (1u << order); i++) {
+        free_block(start_page + i, 0);
     }
 
     return m_lower.offset(Memory::kPageSize * start_page);
 }
 
-Expected<PhysicalAddress> PhysicalRegion::allocate_page()
+Expected<PhysicalAddress> PhysicalRegion::allocate_aligned_pages(u32 number_of_pages, u32 alignment)
 {
-    PhysicalAddress address;
-
-    if (m_used_pages >= m_total_pages) {
-        return Result(Memory::kOutOfMemory);
+    ASSERT(alignment % Memory::kPageSize == 0);
+    if (number_of_pages == 0 || m_total_pages - m_used_pages < number_of_pages) {
+        return Result(Status::Failure);
     }
 
-    for (u32 i = m_last_allocated_page; i < m_total_pages; i++) {
-        if (!m_bitmap.get(i)) {
-            allocate_page_at(i);
-            m_last_allocated_page = i;
-            return m_lower.offset(Memory::kPageSize * i);
+    // Buddy blocks are only aligned relative to the start of the region, so physically aligned
+    // runs are found by looking for free frames and claimed from the blocks they sit in
+    u32 alignment_pages = alignment / Memory::kPageSize;
+    u32 lower_remainder = m_lower.get() % alignment;
+    u32 start_page = lower_remainder == 0 ? 0 : (alignment - lower_remainder) / Memory::kPageSize;
+
+    for (; start_page + number_of_pages <= m_total_pages; start_page += alignment_pages) {
+        bool is_free = true;
+        for (u32 i = 0; i < number_of_pages && is_free; i++) {
+            is_free = m_frames[start_page + i].is_free();
         }
 
-        if (i >= m_total_pages) {
-            i = 0;
-        } else if (i == m_last_allocated_page - 1) {
-            break;
+        if (!is_free) {
+            continue;
+        }
+
+        for (u32 i = 0; i < number_of_pages; i++) {
+            claim_free_page(start_page + i);
+            allocate_page_at(start_page + i);
         }
+        return m_lower.offset(Memory::kPageSize * start_page);
     }
 
-    dbgprintf("PhysicalRegion", "No free pages left!\n");
     return Result(Memory::kOutOfMemory);
 }
 
+Expected<PhysicalAddress> PhysicalRegion::allocate_page()
+{
+    if (m_used_pages >= m_total_pages) {
+        return Result(Memory::kOutOfMemory);
+    }
+
+    auto page_index = allocate_block(0);
+    if (page_index.is_error()) {
+        dbgprintf("PhysicalRegion", "No free pages left!\n");
+        return page_index.error();
+    }
+
+    allocate_page_at(page_index.value());
+    return m_lower.offset(Memory::kPageSize * page_index.value());
+}
+
 Result PhysicalRegion::free_page(PhysicalAddress address)
 {
-    if (address < m_lower || address > m_upper || m_used_pages == 0) {
+    if (!includes(address) || m_used_pages == 0) {
         return Memory::kAddressOutOfRange;
     }
 
@@ -97,44 +152,164 @@ Result PhysicalRegion::free_page(PhysicalAddress address)
     }
 
     u32 address_index = (address - m_lower) / Memory::kPageSize;
-    m_bitmap.set(address_index, false);
+    auto& frame = m_frames[address_index];
+    if (frame.is_free()) {
+        return Status::Failure;
+    }
+
+    // Shared pages are only released once the last sharer lets go of them
+    if (frame.ref_count > 1) {
+        frame.ref_count--;
+        return Status::OK;
+    }
+
+    frame.ref_count = 0;
+    frame.map_count = 0;
+    frame.flags = 0;
     m_used_pages--;
+    free_block(address_index, 0);
 
     dbgprintf_if(DEBUG_PHYSICAL_REGION, "PhysicalRegion", "Freed physical page at 0x%x\n", address);
     return Status::OK;
 }
 
-void PhysicalRegion::allocate_page_at(u32 page_index)
+Result PhysicalRegion::share_page(PhysicalAddress address)
 {
-    ASSERT(!m_bitmap.get(page_index));
-    m_bitmap.set(page_index, true);
-    m_used_pages++;
-    dbgprintf_if(DEBUG_PHYSICAL_REGION, "PhysicalRegion", "Allocated physical page at 0x%x\n",
-        m_lower.offset(Memory::kPageSize * page_index));
+    if (!includes(address)) {
+        return Memory::kAddressOutOfRange;
+    }
+
+    auto& frame = m_frames[(address - m_lower) / Memory::kPageSize];
+    // The count would wrap around and the page be freed while still in use
+    if (frame.is_free() || frame.ref_count == UINT16_MAX) {
+        return Status::Failure;
+    }
+
+    frame.ref_count++;
+    return Status::OK;
 }
 
-Expected<u32> PhysicalRegion::find_contiguous_pages(u32 number_of_pages)
+u16 PhysicalRegion::share_count(PhysicalAddress address) const
 {
-    if (m_used_pages >= m_total_pages) {
+    if (!includes(address)) {
+        return 0;
+    }
+
+    return m_frames[(address - m_lower) / Memory::kPageSize].ref_count;
+}
+
+void PhysicalRegion::dump_statistics() const
+{
+    dbgprintf("PhysicalRegion", "0x%08x:0x%08x %u pages used, %u pages total\n", m_lower, m_upper, m_used_pages, m_total_pages);
+    for (u8 order = 0; order <= kMaxOrder; order++) {
+        dbgprintf("PhysicalRegion", "  Order %u: %u free blocks\n", order, m_free_block_counts[order]);
+    }
+}
+
+Expected<u32> PhysicalRegion::allocate_block(u8 order)
+{
+    u8 current_order = order;
+    while (current_order <= kMaxOrder && m_free_lists[current_order] == kNoPage) {
+        current_order++;
+    }
+
+    if (current_order > kMaxOrder) {
         return Result(Memory::kOutOfMemory);
     }
 
-    u32 start_page = 0;
-    u32 number_of_pages_found = 0;
-    for (u32 i = 0; i < m_total_pages; i++) {
-        if (!m_bitmap.get(i)) {
-            number_of_pages_found++;
-            if (number_of_pages_found == number_of_pages) {
-                break;
-            }
-        } else {
-            number_of_pages_found = 0;
-            start_page = i + 1;
+    u32 page_index = m_free_lists[current_order];
+    remove_free_block(page_index, current_order);
+
+    // Split the block down to the requested order, the upper halves become free buddies
+    while (current_order > order) {
+        current_order--;
+        add_free_block(page_index + (1u << current_order), current_order);
+    }
+
+    return page_index;
+}
+
+void PhysicalRegion::free_block(u32 page_index, u8 order)
+{
+    // Merge with the buddy for as long as it is a free block of the same order
+    while (order < kMaxOrder) {
+        u32 buddy_index = page_index ^ (1u << order);
+        if (buddy_index >= m_total_pages || m_frames[buddy_index].block_order != order) {
+            break;
         }
+
+        remove_free_block(buddy_index, order);
+        page_index &= ~(1u << order);
+        order++;
     }
 
-    if (number_of_pages_found != number_of_pages) {
-        return Result(Status::Failure);
+    add_free_block(page_index, order);
+}
+
+void PhysicalRegion::add_free_block(u32 page_index, u8 order)
+{
+    u32 head = m_free_lists[order];
+
+    m_frames[page_index].next_free_block = head;
+    m_frames[page_index].previous_free_block = kNoPage;
+    if (head != kNoPage) {
+        m_frames[head].previous_free_block = page_index;
+    }
+
+    m_free_lists[order] = page_index;
+    m_frames[page_index].block_order = order;
+    m_free_block_counts[order]++;
+}
+
+void PhysicalRegion::remove_free_block(u32 page_index, u8 order)
+{
+    ASSERT(m_frames[page_index].block_order == order);
+
+    auto& frame = m_frames[page_index];
+    if (frame.previous_free_block != kNoPage) {
+        m_frames[frame.previous_free_block].next_free_block = frame.next_free_block;
+    } else {
+        m_free_lists[order] = frame.next_free_block;
     }
-    return start_page;
+
+    if (frame.next_free_block != kNoPage) {
+        m_frames[frame.next_free_block].previous_free_block = frame.previous_free_block;
+    }
+
+    m_frames[page_index].block_order = PageFrame::kNotFreeBlock;
+    m_free_block_counts[order]--;
+}
+
+void PhysicalRegion::claim_free_page(u32 page_index)
+{
+    // Find the free block holding the page, block heads record their own order
+    u8 order = 0;
+    u32 block_index = page_index;
+    while (m_frames[block_index].block_order != order) {
+        order++;
+        ASSERT(order <= kMaxOrder);
+        block_index = page_index & ~((1u << order) - 1);
+    }
+
+    // Split it down to the page, the halves without the page stay free
+    remove_free_block(block_index, order);
+    while (order > 0) {
+        order--;
+        u32 half = 1u << order;
+        if (page_index & half) {
+            add_free_block(block_index, order);
+            block_index += half;
+        } else {
+            add_free_block(block_index + half, order);
+        }
+    }
+}
+
+void PhysicalRegion::allocate_page_at(u32 page_index)
+{
+    ASSERT(m_frames[page_index].is_free());
+    m_frames[page_index].ref_count = 1;
+    m_used_pages++;
+    dbgprintf_if(DEBUG_PHYSICAL_REGION, "PhysicalRegion", "Allocated physical page at 0x%x\n",
+        m_lower.offset(Memory::kPageSize * page_index));
 }
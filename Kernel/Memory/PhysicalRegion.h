@@ -7,13 +7,15 @@
 #pragma once
 
 #include <Kernel/Memory/Address.h>
-#include <Universal/Bitmap.h>
+#include <Kernel/Memory/PageFrame.h>
 #include <Universal/Expected.h>
 #include <Universal/RefCounted.h>
 #include <Universal/SharedPtr.h>
 
 class PhysicalRegion : public RefCounted<PhysicalRegion> {
 public:
+    static constexpr u8 kMaxOrder = 10;
+
     static SharedPtr<PhysicalRegion> create(PhysicalAddress lower, PhysicalAddress upper);
 
     PhysicalRegion() { }
@@ -24,27 +26,54 @@ public:
 
     [[nodiscard]] bool includes(PhysicalAddress address) const
     {
-        return address > m_lower && address < m_upper;
+        return address >= m_lower && address < m_upper;
     }
 
-    u32 commit();
+    u32 commit(PageFrame* frames, u8 region_index);
     Expected<PhysicalAddress> allocate_contiguous_pages(u32 number_of_pages);
+    Expected<PhysicalAddress> allocate_aligned_pages(u32 number_of_pages, u32 alignment);
     Expected<PhysicalAddress> allocate_page();
     Result free_page(PhysicalAddress);
 
+    Result share_page(PhysicalAddress);
+    u16 share_count(PhysicalAddress) const;
+
+    u32 page_count() const { return (m_upper - m_lower) / Memory::kPageSize; }
+
     const PhysicalAddress lower() const { return m_lower; }
     const PhysicalAddress upper() const { return m_upper; }
 
+    u32 total_pages() const { return m_total_pages; }
+    u32 used_pages() const { return m_used_pages; }
+    u32 free_block_count(u8 order) const { return m_free_block_counts[order]; }
+
+    void dump_statistics() const;
+
 private:
+    static constexpr u32 kNoPage = 0xffffffff;
+
     PhysicalRegion(PhysicalAddress lower, PhysicalAddress upper);
 
+    Expected<u32> allocate_block(u8 order);
+    void free_block(u32 page_index, u8 order);
+
+    void add_free_block(u32 page_index, u8 order);
+    void remove_free_block(u32 page_index, u8 order);
+
+    void claim_free_page(u32 page_index);
     void allocate_page_at(u32 page_index);
-    Expected<u32> find_contiguous_pages(u32 number_of_pages);
 
     PhysicalAddress m_lower;
     PhysicalAddress m_upper;
     u32 m_total_pages { 0 };
     u32 m_used_pages { 0 };
-    u32 m_last_allocated_page { 0 };
-    Bitmap m_bitmap;
+
+    // Buddy allocator state: the free list heads for every order. The order and links of each
+    // free block are kept in the frame of its first page, so nothing comes from the kernel heap.
+    u32 m_free_lists[kMaxOrder + 1];
+    u32 m_free_block_counts[kMaxOrder + 1] {};
+
+    // This region's slice of the MemoryManager's frame database, the reference counts double
+    // as the allocated marker
+    PageFrame* m_frames { nullptr };
 };
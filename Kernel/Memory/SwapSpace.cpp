@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2025, Jason Long <jasonlongball@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <Kernel/Memory/PagingTypes.h>
+#include <Kernel/Memory/SwapSpace.h>
+#include <Kernel/Process/ProcessManager.h>
+#include <Kernel/kmalloc.h>
+#include <Universal/Logger.h>
+#include <Universal/Stdlib.h>
+
+#define DEBUG_SWAP_SPACE 0
+
+UniquePtr<SwapSpace> SwapSpace::create(UniquePtr<BlockDevice> device, u32 block_count)
+{
+    u32 slot_count = block_count / (Memory::kPageSize / device->block_size());
+    if (slot_count == 0) {
+        return nullptr;
+    }
+    return make_unique_ptr<SwapSpace>(move(device), slot_count);
+}
+
+SwapSpace::SwapSpace(UniquePtr<BlockDevice> device, u32 slot_count)
+    : m_device(move(device))
+    , m_slot_count(slot_count)
+{
+    m_blocks_per_slot = Memory::kPageSize / m_device->block_size();
+
+    m_slots = Bitmap::wrap(static_cast<u8*>(kmalloc(calculate_minimum_bytes(slot_count))), slot_count);
+    m_slots.fill(0);
+
+    dbgprintf("SwapSpace", "Swap space of %u pages (%u KiB) enabled\n", m_slot_count, m_slot_count * Memory::kPageSize / 1024);
+}
+
+SwapSpace::~SwapSpace()
+{
+    kfree(m_slots.data());
+}
+
+Expected<u32> SwapSpace::allocate_slot()
+{
+    // Slots are handed out and freed by processes that can be interrupted in between
+    PM.enter_critical();
+    for (size_t i = 0; i < m_slot_count && !is_full(); i++) {
+        u32 slot = (m_next_slot + i) % m_slot_count;
+        if (!m_slots.get(slot)) {
+            m_slots.set(slot, true);
+            m_used_slots++;
+            m_next_slot = slot + 1;
+            PM.exit_critical();
+            return slot;
+        }
+    }
+    PM.exit_critical();
+
+    return Result(Memory::kOutOfMemory);
+}
+
+void SwapSpace::free_slot(u32 slot)
+{
+    PM.enter_critical();
+    ASSERT(slot < m_slot_count && m_slots.get(slot));
+    m_slots.set(slot, false);
+    m_used_slots--;
+
+    if (slot < m_next_slot) {
+        m_next_slot = slot;
+    }
+    PM.exit_critical();
+}
+
+Result SwapSpace::write_page(u32 slot, const u8* page)
+{
+    ASSERT(m_slots.get(slot));
+    dbgprintf_if(DEBUG_SWAP_SPACE, "SwapSpace", "Writing page to slot %u\n", slot);
+    return m_device->write_blocks(slot * m_blocks_per_slot, m_blocks_per_slot, page);
+}
+
+Result SwapSpace::read_page(u32 slot, u8* page)
+{
+    ASSERT(m_slots.get(slot));
+    dbgprintf_if(DEBUG_SWAP_SPACE, "SwapSpace", "Reading page from slot %u\n", slot);
+    return m_device->read_blocks(slot * m_blocks_per_slot, m_blocks_per_slot, page);
+}
+
+Expected<u32> SwapSpace::duplicate_slot(u32 slot)
+{
+    // Staged through a kernel buffer so copying never needs a physical page, one per copy
+    // since another process can fork while this one waits on the disk
+    auto* buffer = static_cast<u8*>(kmalloc(Memory::kPageSize));
+    if (buffer == nullptr) {
+        return Result(Memory::kOutOfMemory);
+    }
+
+    auto copy = allocate_slot();
+    if (copy.is_error()) {
+        kfree(buffer);
+        return copy;
+    }
+
+    Result result = read_page(slot, buffer);
+    if (result.is_ok()) {
+        result = write_page(copy.value(), buffer);
+    }
+    kfree(buffer);
+
+    if (result.is_error()) {
+        free_slot(copy.value());
+        return result;
+    }
+    return copy.value();
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2025, Jason Long <jasonlongball@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <Kernel/Devices/BlockDevice.h>
+#include <Universal/Bitmap.h>
+#include <Universal/Expected.h>
+#include <Universal/UniquePtr.h>
+
+// A block device carved into page sized slots that evicted user pages are written to. A bitmap
+// records which slots hold a page, the regions that own the pages remember which slot is theirs.
+class SwapSpace {
+public:
+    static UniquePtr<SwapSpace> create(UniquePtr<BlockDevice>, u32 block_count);
+
+    SwapSpace(UniquePtr<BlockDevice>, u32 slot_count);
+    ~SwapSpace();
+
+    size_t slot_count() const { return m_slot_count; }
+    size_t used_slots() const { return m_used_slots; }
+    bool is_full() const { return m_used_slots == m_slot_count; }
+
+    Expected<u32> allocate_slot();
+    void free_slot(u32 slot);
+
+    Result write_page(u32 slot, const u8* page);
+    Result read_page(u32 slot, u8* page);
+    // Gives the copy its own slot, used when a process with swapped out pages forks
+    Expected<u32> duplicate_slot(u32 slot);
+
+private:
+    UniquePtr<BlockDevice> m_device;
+    u32 m_blocks_per_slot { 0 };
+
+    Bitmap m_slots;
+    size_t m_slot_count { 0 };
+    size_t m_used_slots { 0 };
+    // Where the search for a free slot starts, slots below it were all in use last time
+    u32 m_next_slot { 0 };
+};
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2025, Jason Long <jasonlongball@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <Kernel/Memory/PagingTypes.h>
+#include <Kernel/Memory/UserCopy.h>
+#include <Universal/Number.h>
+
+struct ExceptionTableEntry {
+    u32 instruction_address;
+    u32 fixup_address;
+};
+
+extern "C" {
+u32 user_memcpy(void* destination, const void* source, size_t length);
+i32 user_strnlen(const char* string, size_t max_length);
+
+extern ExceptionTableEntry g_exception_table_start[];
+extern ExceptionTableEntry g_exception_table_end[];
+}
+
+// The kernel's own memory is always mapped, so it has to be rejected before copying
+static bool is_user_range(const void* address, size_t length)
+{
+    u32 lower = reinterpret_cast<u32>(address);
+    return lower >= Memory::kUserVirtualBase && lower <= Memory::kKernelVirtualBase && length <= Memory::kKernelVirtualBase - lower;
+}
+
+Result copy_from_user(void* destination, const void* user_source, size_t length)
+{
+    if (!is_user_range(user_source, length) || user_memcpy(destination, user_source, length) != 0) {
+        return Status::Failure;
+    }
+    return Status::OK;
+}
+
+Result copy_to_user(void* user_destination, const void* source, size_t length)
+{
+    if (!is_user_range(user_destination, length) || user_memcpy(user_destination, source, length) != 0) {
+        return Status::Failure;
+    }
+    return Status::OK;
+}
+
+Expected<size_t> strnlen_from_user(const char* user_string, size_t max_length)
+{
+    u32 lower = reinterpret_cast<u32>(user_string);
+    if (lower < Memory::kUserVirtualBase || lower >= Memory::kKernelVirtualBase) {
+        return Result(Status::Failure);
+    }
+
+    // Never look past the end of user memory while searching for the terminator, a string that
+    // runs into it has no terminator either
+    size_t scan_length = min(max_length, (size_t)(Memory::kKernelVirtualBase - lower));
+    i32 length = user_strnlen(user_string, scan_length);
+    if (length < 0 || (size_t)length >= scan_length) {
+        return Result(Status::Failure);
+    }
+    return (size_t)length;
+}
+
+Expected<size_t> strncpy_from_user(char* destination, const char* user_source, size_t length)
+{
+    size_t string_length = TRY_TAKE(strnlen_from_user(user_source, length));
+    TRY(copy_from_user(destination, user_source, string_length));
+    destination[string_length] = '\0';
+    return string_length;
+}
+
+u32 find_user_copy_fixup(u32 instruction_address)
+{
+    for (auto* entry = g_exception_table_start; entry < g_exception_table_end; entry++) {
+        if (entry->instruction_address == instruction_address) {
+            return entry->fixup_address;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2025, Jason Long <jasonlongball@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <Universal/Expected.h>
+#include <Universal/Result.h>
+#include <Universal/Types.h>
+
+// Copies between kernel memory and the current process's memory. A bad user pointer makes
+// these fail instead of panicking, so syscalls do not need to validate pointers beforehand.
+Result copy_from_user(void* destination, const void* user_source, size_t length);
+Result copy_to_user(void* user_destination, const void* source, size_t length);
+
+// Returns the length of a user string, failing if it has no terminator within max_length bytes
+Expected<size_t> strnlen_from_user(const char* user_string, size_t max_length);
+
+// Copies a string of at most length - 1 characters and always terminates the destination.
+// Fails if the user string is longer than that.
+Expected<size_t> strncpy_from_user(char* destination, const char* user_source, size_t length);
+
+// Returns where to resume after a fault at the given instruction, or 0 if the fault is not expected
+u32 find_user_copy_fixup(u32 instruction_address);
@@ -4,16 +4,121 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#include <Kernel/Filesystem/FileDescriptor.h>
+#include <Kernel/Filesystem/Inode.h>
+#include <Kernel/Filesystem/InodeFile.h>
 #include <Kernel/Memory/MemoryManager.h>
 #include <Kernel/Memory/VMObject.h>
+#include <Kernel/Process/ProcessManager.h>
+#include <Universal/Logger.h>
+#include <Universal/Number.h>
 
-VMObject::VMObject(size_t size)
-    : m_physical_pages(size)
+#define DEBUG_VM_OBJECT 0
+
+SharedPtr<VMObject> VMObject::create_anonymous(size_t page_count)
+{
+    return adopt_shared_ptr(*new VMObject(page_count));
+}
+
+Expected<SharedPtr<VMObject>> VMObject::find_or_create_for_file(FileDescriptor& file_descriptor)
+{
+    if (!file_descriptor.file().is_inode()) {
+        return Result(Status::Failure);
+    }
+
+    auto& inode = static_cast<InodeFile&>(file_descriptor.file()).inode();
+    if (inode.is_directory() || inode.is_device()) {
+        return Result(Status::Failure);
+    }
+
+    auto* cached_object = MM.find_vm_object(inode);
+    if (cached_object != nullptr) {
+        return SharedPtr<VMObject>(*cached_object);
+    }
+
+    auto vm_object = adopt_shared_ptr(*new VMObject(ceiling_divide((size_t)inode.size(), Memory::kPageSize)));
+    vm_object->m_file_descriptor = file_descriptor;
+    vm_object->m_inode = &inode;
+
+    dbgprintf_if(DEBUG_VM_OBJECT, "VMObject", "Created page cache for inode %u with %u pages\n", inode.id(), vm_object->page_count());
+    return vm_object;
+}
+
+VMObject::VMObject(size_t page_count)
+    : m_physical_pages(page_count)
 {
     MemoryManager::the().add_vm_object(*this);
 }
 
 VMObject::~VMObject()
 {
+    for (size_t i = 0; i < m_physical_pages.size(); i++) {
+        if (!m_physical_pages[i].is_null()) {
+            MM.free_physical_user_page(m_physical_pages[i]);
+        }
+    }
+
     MemoryManager::the().remove_vm_object(*this);
 }
+
+bool VMObject::is_backing(const Inode& inode) const
+{
+    return m_inode != nullptr && m_inode->fs().id() == inode.fs().id() && m_inode->id() == inode.id();
+}
+
+Expected<PhysicalAddress> VMObject::get_page(size_t page_index)
+{
+    if (page_index >= m_physical_pages.size()) {
+        return Result(Status::Failure);
+    }
+
+    if (m_physical_pages[page_index].is_null()) {
+        TRY(load_page(page_index));
+    }
+
+    return m_physical_pages[page_index];
+}
+
+Result VMObject::load_page(size_t page_index)
+{
+    auto physical_page = TRY_TAKE(MM.allocate_zeroed_physical_user_page());
+    if (!is_file_backed()) {
+        store_loaded_page(page_index, physical_page);
+        return Status::OK;
+    }
+
+    // The tail of the last page past the end of the file stays zeroed
+    size_t offset = page_index * Memory::kPageSize;
+    size_t length = min((size_t)Memory::kPageSize, (size_t)m_inode->size() - offset);
+
+    auto mapped_page = MUST_TAKE(MM.temporary_map(physical_page));
+    ssize_t bytes_read = m_inode->read(*m_file_descriptor, offset, length, mapped_page.ptr());
+    MM.temporary_unmap(mapped_page);
+
+    if (bytes_read < 0 || (size_t)bytes_read != length) {
+        MM.free_physical_user_page(physical_page);
+        return Status::Failure;
+    }
+
+    MM.page_frame(physical_page)->set_flag(PageFrame::PageCache, true);
+
+    dbgprintf_if(DEBUG_VM_OBJECT, "VMObject", "Loaded page %u of inode %u\n", page_index, m_inode->id());
+    store_loaded_page(page_index, physical_page);
+    return Status::OK;
+}
+
+void VMObject::store_loaded_page(size_t page_index, PhysicalAddress physical_page)
+{
+    // Another process faulting on the same page may have loaded it while this one waited for
+    // memory or the disk. The first copy stored is the one every mapping shares.
+    PM.enter_critical();
+    bool is_already_loaded = !m_physical_pages[page_index].is_null();
+    if (!is_already_loaded) {
+        m_physical_pages[page_index] = physical_page;
+    }
+    PM.exit_critical();
+
+    if (is_already_loaded) {
+        MM.free_physical_user_page(physical_page);
+    }
+}
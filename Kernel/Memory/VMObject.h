@@ -8,19 +8,42 @@
 
 #include <Kernel/Memory/Address.h>
 #include <Universal/Array.h>
+#include <Universal/Expected.h>
 #include <Universal/LinkedList.h>
 #include <Universal/RefCounted.h>
 #include <Universal/SharedPtr.h>
 
+class FileDescriptor;
+class Inode;
+
+// The pages of a memory object that can be mapped into many regions at once. File backed
+// objects are the page cache of their inode: there is at most one per inode, pages are read
+// in from the file the first time they are faulted and every mapping of the file shares them.
 class VMObject : public RefCounted<VMObject>
     , public LinkedListNode<VMObject> {
 public:
-    VMObject(size_t);
+    static SharedPtr<VMObject> create_anonymous(size_t page_count);
+    static Expected<SharedPtr<VMObject>> find_or_create_for_file(FileDescriptor&);
+
+    VMObject(size_t page_count);
     ~VMObject();
 
+    bool is_file_backed() const { return !m_file_descriptor.is_null(); }
+    bool is_backing(const Inode&) const;
+
+    size_t page_count() const { return m_physical_pages.size(); }
+
+    Expected<PhysicalAddress> get_page(size_t page_index);
+
     VMObject* m_next { nullptr };
     VMObject* m_previous { nullptr };
 
 private:
+    Result load_page(size_t page_index);
+    void store_loaded_page(size_t page_index, PhysicalAddress);
+
     Array<PhysicalAddress> m_physical_pages;
+
+    SharedPtr<FileDescriptor> m_file_descriptor;
+    Inode* m_inode { nullptr };
 };
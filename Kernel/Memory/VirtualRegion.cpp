@@ -5,7 +5,23 @@
  */
 
 #include <Kernel/Memory/MemoryManager.h>
+#include <Kernel/Memory/PageMerger.h>
 #include <Kernel/Memory/VirtualRegion.h>
+#include <Kernel/Process/ProcessManager.h>
+
+static Expected<PhysicalAddress> copy_physical_page(PhysicalAddress source)
+{
+    PhysicalAddress pages[] = { source, TRY_TAKE(MM.allocate_physical_user_page()) };
+    auto mapping = MM.temporary_map(pages, 2);
+    if (mapping.is_error()) {
+        MM.free_physical_user_page(pages[1]);
+        return mapping.error();
+    }
+
+    memcpy(mapping.value().offset(Memory::kPageSize).ptr(), mapping.value().ptr(), Memory::kPageSize);
+    MM.temporary_unmap(mapping.value(), 2);
+    return pages[1];
+}
 
 VirtualRegion::VirtualRegion(const AddressRange& address_range, u8 access, bool is_kernel_region)
     : m_address_range(address_range)
@@ -24,8 +40,8 @@ VirtualRegion::~VirtualRegion()
 UniquePtr<VirtualRegion> VirtualRegion::create_kernel_region(const AddressRange& address_range, u8 access)
 {
     auto region = make_unique_ptr<VirtualRegion>(address_range, access, true);
-    for (size_t i = 0; i < region->m_physical_pages.size(); i++) {
-        region->m_physical_pages[i] = MM.allocate_physical_kernel_page();
+    for (size_t i = 0; i < region->page_count(); i++) {
+        region->m_physical_pages.set_page(i, MM.allocate_physical_kernel_page());
     }
     return region;
 }
@@ -33,49 +49,184 @@ UniquePtr<VirtualRegion> VirtualRegion::create_kernel_region(const AddressRange&
 UniquePtr<VirtualRegion> VirtualRegion::create_kernel_dma_region(const AddressRange& address_range, u8 access)
 {
     auto region = make_unique_ptr<VirtualRegion>(address_range, access, true);
-    auto start_address = MM.allocate_physical_contiguous_kernel_pages(region->m_physical_pages.size());
-    for (size_t i = 0; i < region->m_physical_pages.size(); i++) {
-        region->m_physical_pages[i] = start_address.offset(i * Memory::kPageSize);
-    }
+    auto start_address = MM.allocate_physical_contiguous_kernel_pages(region->page_count());
+    region->m_physical_pages.set_pages(0, start_address, region->page_count());
     return region;
 }
 
 UniquePtr<VirtualRegion> VirtualRegion::create_kernel_region_at(PhysicalAddress physical_address, const AddressRange& address_range, u8 access)
 {
     auto region = make_unique_ptr<VirtualRegion>(address_range, access, true);
-    for (size_t i = 0; i < region->m_physical_pages.size(); i++) {
-        region->m_physical_pages[i] = physical_address.offset(i * Memory::kPageSize);
+    region->m_physical_pages.set_pages(0, physical_address, region->page_count());
+    return region;
+}
+
+UniquePtr<VirtualRegion> VirtualRegion::create_user_region(const AddressRange& address_range, u8 access, AllocationStrategy allocation_strategy)
+{
+    auto region = make_unique_ptr<VirtualRegion>(address_range, access, false);
+
+    // Lazy regions only reserve their address range, pages are zero-filled on first touch
+    if (allocation_strategy == Lazy) {
+        return region;
+    }
+
+    for (size_t i = 0; i < region->page_count(); i++) {
+        auto physical_page = MM.allocate_zeroed_physical_user_page();
+        if (physical_page.is_error()) {
+            MUST(region->free());
+            return nullptr;
+        }
+        region->m_physical_pages.set_page(i, physical_page.value());
     }
     return region;
 }
 
-UniquePtr<VirtualRegion> VirtualRegion::create_user_region(const AddressRange& address_range, u8 access)
+UniquePtr<VirtualRegion> VirtualRegion::create_user_region(const AddressRange& address_range, u8 access, SharedPtr<VMObject> vm_object, size_t vm_object_page_offset, Sharing sharing)
 {
+    // Pages come from the memory object as they are faulted in
     auto region = make_unique_ptr<VirtualRegion>(address_range, access, false);
-    for (size_t i = 0; i < region->m_physical_pages.size(); i++) {
-        region->m_physical_pages[i] = MM.allocate_physical_user_page();
+    region->m_vm_object = move(vm_object);
+    region->m_vm_object_page_offset = vm_object_page_offset;
+    region->m_is_shared = sharing == Shared;
+    return region;
+}
+
+UniquePtr<VirtualRegion> VirtualRegion::create_user_huge_region(const AddressRange& address_range, u8 access)
+{
+    ASSERT(address_range.lower().get() % Memory::kLargePageSize == 0 && address_range.length() % Memory::kLargePageSize == 0);
+
+    auto region = make_unique_ptr<VirtualRegion>(address_range, access, false);
+    region->m_is_huge = true;
+
+    for (size_t i = 0; i < region->large_page_count(); i++) {
+        auto large_page = MM.allocate_physical_user_large_page();
+        if (large_page.is_error()) {
+            MUST(region->free());
+            return nullptr;
+        }
+        region->m_physical_pages.set_pages(i * Memory::kPageTableEntryCount, large_page.value(), Memory::kPageTableEntryCount);
+    }
+    return region;
+}
+
+UniquePtr<VirtualRegion> VirtualRegion::clone()
+{
+    ASSERT(!m_is_kernel_region);
+
+    // Large pages are too big to share copy-on-write, the child gets its own copy right away
+    if (m_is_huge) {
+        auto region = create_user_huge_region(m_address_range, m_access);
+        if (region.ptr() != nullptr && is_readable()) {
+            region->copy_from(*this);
+        }
+        return region;
+    }
+
+    auto region = make_unique_ptr<VirtualRegion>(m_address_range, m_access, false);
+    region->m_vm_object = m_vm_object;
+    region->m_vm_object_page_offset = m_vm_object_page_offset;
+    region->m_is_shared = m_is_shared;
+    region->m_access_pattern = m_access_pattern;
+
+    // Swapped out pages are copied entry to entry, the child can not share one with the parent
+    for (auto* node = m_swap_entries.first(); node != nullptr; node = RedBlackTree<size_t, u32>::next(node)) {
+        auto swap_entry = MM.duplicate_swap_entry(node->value());
+        if (swap_entry.is_error()) {
+            MUST(region->free());
+            return nullptr;
+        }
+        region->m_swap_entries.insert(node->key(), swap_entry.value());
+    }
+
+    // A frame already shared by as many as its count can hold gets copied for the child instead
+    bool is_out_of_memory = false;
+    m_physical_pages.for_each_extent([&](const PhysicalExtent& extent) {
+        size_t shared_page = extent.first_page;
+        for (size_t page_index = extent.first_page; page_index < extent.end_page() && !is_out_of_memory; page_index++) {
+            if (MM.share_physical_user_page(extent.page(page_index)).is_ok()) {
+                continue;
+            }
+
+            if (page_index > shared_page) {
+                region->m_physical_pages.set_pages(shared_page, extent.page(shared_page), page_index - shared_page);
+            }
+            shared_page = page_index + 1;
+
+            auto copied_page = copy_physical_page(extent.page(page_index));
+            if (copied_page.is_error()) {
+                is_out_of_memory = true;
+                return;
+            }
+            region->m_physical_pages.set_page(page_index, copied_page.value());
+        }
+
+        if (!is_out_of_memory && extent.end_page() > shared_page) {
+            region->m_physical_pages.set_pages(shared_page, extent.page(shared_page), extent.end_page() - shared_page);
+        }
+    });
+
+    if (is_out_of_memory) {
+        MUST(region->free());
+        return nullptr;
+    }
+
+    // Every page is shared now, so remap to drop write access until one of the
+    // sharers faults and takes its own copy
+    if (is_writable() && !m_page_directory.is_null()) {
+        map(*m_page_directory);
     }
+
     return region;
 }
 
 void VirtualRegion::map(PageDirectory& page_directory)
+{
+    map_pages(page_directory, 0, page_count());
+}
+
+void VirtualRegion::map_pages(PageDirectory& page_directory, size_t first_page, size_t count)
 {
     if (m_page_directory.is_null()) {
         m_page_directory = page_directory;
     }
 
-    for (size_t i = 0; i < m_physical_pages.size(); i++) {
-        auto page_virtual_address = m_address_range.lower().offset(i * Memory::kPageSize);
-        auto& page_table_entry = MM.get_page_table_entry(page_directory, page_virtual_address, !m_is_kernel_region);
-        auto physical_page = m_physical_pages[i];
+    if (m_is_huge) {
+        map_large_pages(page_directory);
+        return;
+    }
 
-        page_table_entry.set_physical_page_base(physical_page.get());
-        page_table_entry.set_user(!m_is_kernel_region);
-        page_table_entry.set_present(is_readable());
-        page_table_entry.set_read_write(is_writable());
+    bool is_user = !m_is_kernel_region;
+    u32 flags = (is_readable() ? PageTableEntry::Present : 0) | (is_user ? PageTableEntry::UserSupervisor : PageTableEntry::Global);
+    size_t end_page = first_page + count;
 
-        Memory::invalidate_page(page_virtual_address);
-    }
+    // Pages outside of every extent are not backed yet and stay non-present until they are faulted in
+    m_physical_pages.for_each_extent([&](const PhysicalExtent& extent) {
+        size_t extent_first_page = max(extent.first_page, first_page);
+        size_t extent_end_page = min(extent.end_page(), end_page);
+        if (extent_first_page >= extent_end_page) {
+            return;
+        }
+
+        auto extent_address = lower().offset(extent_first_page * Memory::kPageSize);
+        MM.for_each_page_table(page_directory, extent_address, extent_end_page - extent_first_page, true, is_user, [&](PageTableEntry* entries, VirtualAddress, size_t table_first_page, size_t table_page_count) {
+            auto physical_page = extent.page(extent_first_page + table_first_page);
+            for (size_t i = 0; i < table_page_count; i++, physical_page = physical_page.offset(Memory::kPageSize)) {
+                auto& page_table_entry = entries[i];
+
+                // Remapping an entry that already points at the page only updates its permissions
+                if (page_table_entry.address().page_base() != physical_page.get()) {
+                    add_page_mapping(physical_page);
+                }
+
+                // Shared pages stay read only until their first write so they can be marked dirty,
+                // merged ones so that the write copies them
+                bool can_write = is_writable() && (m_is_shared ? is_page_dirty(physical_page) : !is_page_shared(physical_page) && !is_page_merged(physical_page));
+                page_table_entry.set(physical_page.get(), flags | (can_write ? PageTableEntry::ReadWrite : 0));
+            }
+        });
+    });
+
+    MM.invalidate_range(lower().offset(first_page * Memory::kPageSize), count);
 }
 
 Result VirtualRegion::unmap(PageDirectory& page_directory)
@@ -84,32 +235,253 @@ Result VirtualRegion::unmap(PageDirectory& page_directory)
         return Status::Failure;
     }
 
-    for (size_t i = 0; i < m_physical_pages.size(); i++) {
-        auto page_virtual_address = m_address_range.lower().offset(i * Memory::kPageSize);
-        auto& page_table_entry = MM.get_page_table_entry(page_directory, page_virtual_address, !m_is_kernel_region);
-        auto physical_page = m_physical_pages[i];
+    if (m_is_huge) {
+        for (size_t i = 0; i < large_page_count(); i++) {
+            MM.unmap_large_page(page_directory, lower().offset(i * Memory::kLargePageSize));
+        }
+        return Status::OK;
+    }
 
-        page_table_entry.set_physical_page_base(0);
-        page_table_entry.set_user(false);
-        page_table_entry.set_present(false);
-        page_table_entry.set_read_write(false);
+    m_physical_pages.for_each_extent([&](const PhysicalExtent& extent) {
+        auto extent_address = lower().offset(extent.first_page * Memory::kPageSize);
+        MM.for_each_page_table(page_directory, extent_address, extent.count, false, false, [&](PageTableEntry* entries, VirtualAddress, size_t first_page, size_t count) {
+            if (entries == nullptr) {
+                return;
+            }
 
-        Memory::invalidate_page(page_virtual_address);
-    }
+            auto physical_page = extent.base.offset(first_page * Memory::kPageSize);
+            for (size_t i = 0; i < count; i++, physical_page = physical_page.offset(Memory::kPageSize)) {
+                if (entries[i].address().page_base() == physical_page.get()) {
+                    remove_page_mapping(physical_page);
+                }
+                entries[i].set(0, 0);
+            }
+        });
+    });
 
+    MM.invalidate_range(lower(), page_count());
     return Status::OK;
 }
 
+void VirtualRegion::map_large_pages(PageDirectory& page_directory)
+{
+    // Every large page is backed from the start and never shared, so it can be writable right away
+    u32 flags = PageDirectoryEntry::UserSupervisor | (is_readable() ? PageDirectoryEntry::Present : 0) | (is_writable() ? PageDirectoryEntry::ReadWrite : 0);
+    for (size_t i = 0; i < large_page_count(); i++) {
+        MM.map_large_page(page_directory, lower().offset(i * Memory::kLargePageSize), physical_page(i * Memory::kPageTableEntryCount), flags);
+    }
+}
+
+void VirtualRegion::copy_from(VirtualRegion& other)
+{
+    ASSERT(m_is_huge && other.m_is_huge && page_count() == other.page_count());
+
+    // The source is mapped in the current address space, the copies are reached through
+    // the temporary mapping slots a batch at a time
+    PhysicalAddress pages[Memory::kKernelTemporaryMapSlots];
+    for (size_t first_page = 0; first_page < page_count(); first_page += Memory::kKernelTemporaryMapSlots) {
+        size_t batch = min(Memory::kKernelTemporaryMapSlots, page_count() - first_page);
+        for (size_t i = 0; i < batch; i++) {
+            pages[i] = physical_page(first_page + i);
+        }
+
+        auto mapping = MUST_TAKE(MM.temporary_map(pages, batch));
+        memcpy(mapping.ptr(), other.lower().offset(first_page * Memory::kPageSize).ptr(), batch * Memory::kPageSize);
+        MM.temporary_unmap(mapping, batch);
+    }
+}
+
 Result VirtualRegion::free()
 {
-    for (size_t i = 0; i < m_physical_pages.size(); i++) {
-        if (m_is_kernel_region) {
-            MM.free_physical_kernel_page(m_physical_pages[i]);
+    m_physical_pages.for_each_extent([&](const PhysicalExtent& extent) {
+        for (size_t i = 0; i < extent.count; i++) {
+            auto physical_page = extent.base.offset(i * Memory::kPageSize);
+            if (m_is_kernel_region) {
+                MM.free_physical_kernel_page(physical_page);
+            } else {
+                MM.free_physical_user_page(physical_page);
+            }
+        }
+    });
+
+    release_swap_entries(0, page_count());
+    return Status::OK;
+}
+
+void VirtualRegion::resize(size_t length)
+{
+    ASSERT(!m_is_kernel_region && !m_is_huge);
+
+    size_t new_page_count = ceiling_divide(length, Memory::kPageSize);
+    if (new_page_count < page_count()) {
+        release_pages(new_page_count, page_count() - new_page_count);
+    } else {
+        // Only anonymous memory can grow, a memory object has no pages to give past its end
+        ASSERT(m_vm_object.is_null());
+    }
+
+    // Pages added at the end are zero-filled on first touch like any lazy region
+    m_address_range = AddressRange(lower(), new_page_count * Memory::kPageSize);
+    m_physical_pages.resize(new_page_count);
+}
+
+UniquePtr<VirtualRegion> VirtualRegion::split(size_t page_index)
+{
+    ASSERT(!m_is_kernel_region && !m_is_huge);
+    ASSERT(page_index > 0 && page_index < page_count());
+
+    size_t split_offset = page_index * Memory::kPageSize;
+    auto region = make_unique_ptr<VirtualRegion>(AddressRange(lower().offset(split_offset), length() - split_offset), m_access, false);
+    region->m_page_directory = m_page_directory;
+    region->m_vm_object = m_vm_object;
+    region->m_vm_object_page_offset = m_vm_object_page_offset + page_index;
+    region->m_is_shared = m_is_shared;
+    region->m_access_pattern = m_access_pattern;
+
+    // The pages only change owner, their translations and map counts stay as they are
+    m_physical_pages.for_each_extent([&](const PhysicalExtent& extent) {
+        if (extent.end_page() <= page_index) {
+            return;
+        }
+
+        size_t first_page = max(extent.first_page, page_index);
+        region->m_physical_pages.set_pages(first_page - page_index, extent.page(first_page), extent.end_page() - first_page);
+    });
+
+    auto* node = m_swap_entries.find_smallest_not_below(page_index);
+    while (node != nullptr) {
+        auto* next = RedBlackTree<size_t, u32>::next(node);
+        region->m_swap_entries.insert(node->key() - page_index, node->value());
+        m_swap_entries.remove(node);
+        node = next;
+    }
+
+    m_address_range = AddressRange(lower(), split_offset);
+    m_physical_pages.resize(page_index);
+    return region;
+}
+
+void VirtualRegion::move_to(VirtualAddress new_lower)
+{
+    ASSERT(!m_page_directory.is_null());
+
+    // Only the page table entries move, the pages themselves are not copied
+    auto page_directory = m_page_directory;
+    MUST(unmap(*page_directory));
+    m_address_range = AddressRange(new_lower, length());
+    map(*page_directory);
+}
+
+Result VirtualRegion::populate(size_t first_page, size_t count)
+{
+    ASSERT(!m_is_kernel_region && !m_page_directory.is_null());
+    ASSERT(first_page + count <= page_count());
+
+    if (!is_readable()) {
+        return Status::Failure;
+    }
+
+    if (m_is_huge) {
+        return Status::OK;
+    }
+
+    Result result = Status::OK;
+    size_t end_page = first_page + count;
+    for (size_t page_index = first_page; page_index < end_page; page_index++) {
+        if (is_page_backed(page_index)) {
+            continue;
+        }
+
+        if (is_page_swapped(page_index)) {
+            if (swap_in_page(page_index).is_error()) {
+                result = Status::Failure;
+                end_page = page_index;
+                break;
+            }
+            continue;
+        }
+
+        if (!m_vm_object.is_null() && m_vm_object_page_offset + page_index < m_vm_object->page_count()) {
+            auto physical_page = m_vm_object->get_page(m_vm_object_page_offset + page_index);
+            if (physical_page.is_error() || MM.share_physical_user_page(physical_page.value()).is_error()) {
+                result = Status::Failure;
+                end_page = page_index;
+                break;
+            }
+            m_physical_pages.set_page(page_index, physical_page.value());
         } else {
-            MM.free_physical_user_page(m_physical_pages[i]);
+            auto physical_page = MM.allocate_zeroed_physical_user_page();
+            if (physical_page.is_error()) {
+                result = Status::Failure;
+                end_page = page_index;
+                break;
+            }
+            m_physical_pages.set_page(page_index, physical_page.value());
         }
     }
-    return Status::OK;
+
+    // Everything backed so far gets mapped in one walk, even when the object ran out of pages
+    map_pages(*m_page_directory, first_page, end_page - first_page);
+    return result;
+}
+
+void VirtualRegion::discard(size_t first_page, size_t count)
+{
+    ASSERT(!m_is_kernel_region && !m_is_huge);
+    ASSERT(first_page + count <= page_count());
+    release_pages(first_page, count);
+}
+
+void VirtualRegion::release_pages(size_t first_page, size_t count)
+{
+    size_t end_page = first_page + count;
+
+    m_physical_pages.for_each_extent([&](const PhysicalExtent& extent) {
+        size_t extent_first_page = max(extent.first_page, first_page);
+        size_t extent_end_page = min(extent.end_page(), end_page);
+        if (extent_first_page >= extent_end_page) {
+            return;
+        }
+
+        size_t extent_page_count = extent_end_page - extent_first_page;
+        if (!m_page_directory.is_null()) {
+            auto extent_address = lower().offset(extent_first_page * Memory::kPageSize);
+            MM.for_each_page_table(*m_page_directory, extent_address, extent_page_count, false, false, [&](PageTableEntry* entries, VirtualAddress, size_t table_first_page, size_t table_page_count) {
+                if (entries == nullptr) {
+                    return;
+                }
+
+                auto physical_page = extent.page(extent_first_page + table_first_page);
+                for (size_t i = 0; i < table_page_count; i++, physical_page = physical_page.offset(Memory::kPageSize)) {
+                    if (entries[i].address().page_base() == physical_page.get()) {
+                        remove_page_mapping(physical_page);
+                    }
+                    entries[i].set(0, 0);
+                }
+            });
+        }
+
+        for (size_t i = extent_first_page; i < extent_end_page; i++) {
+            MM.free_physical_user_page(extent.page(i));
+        }
+    });
+
+    if (!m_page_directory.is_null()) {
+        MM.invalidate_range(lower().offset(first_page * Memory::kPageSize), count);
+    }
+    m_physical_pages.clear_pages(first_page, count);
+    release_swap_entries(first_page, count);
+}
+
+void VirtualRegion::release_swap_entries(size_t first_page, size_t count)
+{
+    auto* node = m_swap_entries.find_smallest_not_below(first_page);
+    while (node != nullptr && node->key() < first_page + count) {
+        auto* next = RedBlackTree<size_t, u32>::next(node);
+        MM.free_swap_entry(node->value());
+        m_swap_entries.remove(node);
+        node = next;
+    }
 }
 
 bool VirtualRegion::contains(VirtualAddress address)
@@ -119,16 +491,326 @@ bool VirtualRegion::contains(VirtualAddress address)
 
 bool VirtualRegion::is_accessible(VirtualAddress address, size_t length)
 {
-    return contains(address) && contains(address + length);
+    return contains(address) && length <= upper() - address;
+}
+
+Result VirtualRegion::handle_fault(const PageFault& fault)
+{
+    // Large pages are always present, any fault on them is a real access violation
+    if (m_is_huge) {
+        return Status::Failure;
+    }
+
+    size_t page_index = (fault.address().page_base() - lower().get()) / Memory::kPageSize;
+
+    if (fault.is_not_present() && !is_page_backed(page_index)) {
+        if (!is_readable() || (fault.is_write() && !is_writable())) {
+            return Status::Failure;
+        }
+
+        if (is_page_swapped(page_index)) {
+            TRY(swap_in_page(page_index));
+            map_pages(*m_page_directory, page_index, 1);
+        } else if (!m_vm_object.is_null() && m_vm_object_page_offset + page_index < m_vm_object->page_count()) {
+            TRY(handle_vm_object_fault(page_index, fault));
+        } else {
+            TRY(handle_zero_fault(page_index));
+        }
+
+        // Read ahead so a region walked front to back takes one fault per window instead of one per page
+        if (m_access_pattern == Sequential && page_index + 1 < page_count()) {
+            (void)populate(page_index + 1, min(kSequentialReadAheadPages, page_count() - page_index - 1));
+        }
+        return Status::OK;
+    }
+
+    if (fault.is_protection_violation() && fault.is_write() && is_writable()) {
+        return handle_copy_on_write_fault(page_index);
+    }
+
+    return Status::Failure;
+}
+
+bool VirtualRegion::sweep_page(size_t page_index, PageOut& page_out)
+{
+    ASSERT(can_swap_out() && m_owner != nullptr && !m_owner->is_changing_memory());
+
+    auto physical_page = m_physical_pages.page(page_index);
+    if (physical_page.is_null()) {
+        return false;
+    }
+
+    // Shared pages would have to be unmapped from every sharer, pinned ones must stay put
+    auto* frame = MM.page_frame(physical_page);
+    if (frame == nullptr || frame->has_flag(PageFrame::Pinned) || is_page_shared(physical_page)) {
+        return false;
+    }
+
+    // Pages that are backed but not mapped yet are in the middle of being faulted in
+    auto page_virtual_address = lower().offset(page_index * Memory::kPageSize);
+    auto* page_table = MM.find_page_table(*m_page_directory, page_virtual_address);
+    if (page_table == nullptr) {
+        return false;
+    }
+
+    u16 page_table_index = PAGE_TABLE_INDEX(page_virtual_address);
+    auto& page_table_entry = page_table[page_table_index];
+    if (!page_table_entry.is_present() || page_table_entry.address().page_base() != physical_page.get()) {
+        return false;
+    }
+
+    if (page_table_entry.is_accessed()) {
+        page_table_entry.set_accessed(false);
+        Memory::invalidate_page(page_virtual_address);
+        return false;
+    }
+
+    // The page is in flight until the page out is finished. With its entry cleared the owner
+    // can not change it, and any fault or memory change of the owner waits until it has landed.
+    page_out.region = this;
+    page_out.page_index = page_index;
+    page_out.physical_page = physical_page;
+    page_out.page_table_entry = &page_table_entry;
+    page_out.saved_page_table_entry = page_table_entry;
+
+    page_table_entry.set(0, 0);
+    Memory::invalidate_page(page_virtual_address);
+    m_owner->begin_page_out();
+    return true;
+}
+
+bool VirtualRegion::merge_page(size_t page_index)
+{
+    ASSERT(can_merge());
+
+    // Pages that are already shared or merged are left as they are
+    auto physical_page = m_physical_pages.page(page_index);
+    if (physical_page.is_null()) {
+        return false;
+    }
+
+    auto* frame = MM.page_frame(physical_page);
+    if (frame == nullptr || frame->has_flag(PageFrame::Pinned) || frame->has_flag(PageFrame::Merged) || is_page_shared(physical_page)) {
+        return false;
+    }
+
+    auto page_virtual_address = lower().offset(page_index * Memory::kPageSize);
+    auto* page_table = MM.find_page_table(*m_page_directory, page_virtual_address);
+    if (page_table == nullptr) {
+        return false;
+    }
+
+    u16 page_table_index = PAGE_TABLE_INDEX(page_virtual_address);
+    auto& page_table_entry = page_table[page_table_index];
+    if (!page_table_entry.is_present() || page_table_entry.address().page_base() != physical_page.get()) {
+        return false;
+    }
+
+    // A page written since the last look is still changing and would only be copied again
+    if (page_table_entry.is_dirty()) {
+        page_table_entry.set_dirty(false);
+        Memory::invalidate_page(page_virtual_address);
+        return false;
+    }
+
+    auto mapping = MM.temporary_map(physical_page);
+    if (mapping.is_error()) {
+        return false;
+    }
+
+    auto merged_page = PageMerger::the().find_or_add(physical_page, static_cast<const u8*>(mapping.value().ptr()));
+    MM.temporary_unmap(mapping.value());
+    if (merged_page.is_error()) {
+        return false;
+    }
+
+    // The page is now the one others get merged into, so it stays put but read only
+    if (merged_page.value().get() == physical_page.get()) {
+        page_table_entry.set_read_write(false);
+        Memory::invalidate_page(page_virtual_address);
+        return false;
+    }
+
+    MUST(MM.share_physical_user_page(merged_page.value()));
+    remove_page_mapping(physical_page);
+    m_physical_pages.set_page(page_index, merged_page.value());
+    add_page_mapping(merged_page.value());
+
+    page_table_entry.set_physical_page_base(merged_page.value().get());
+    page_table_entry.set_read_write(false);
+    Memory::invalidate_page(page_virtual_address);
+
+    MUST(MM.free_physical_user_page(physical_page));
+    return true;
+}
+
+void VirtualRegion::finish_page_out(const PageOut& page_out, const Expected<u32>& swap_entry)
+{
+    ASSERT(page_out.region == this);
+    m_owner->end_page_out();
+
+    if (swap_entry.is_error()) {
+        *page_out.page_table_entry = page_out.saved_page_table_entry;
+        return;
+    }
+
+    // The owner could not touch its regions in the meantime, so the page is still where it was
+    auto physical_page = page_out.physical_page;
+    ASSERT(m_physical_pages.page(page_out.page_index).get() == physical_page.get());
+    remove_page_mapping(physical_page);
+    m_physical_pages.clear_pages(page_out.page_index, 1);
+    m_swap_entries.insert(page_out.page_index, swap_entry.value());
+    MUST(MM.free_physical_user_page(physical_page));
+}
+
+Result VirtualRegion::swap_in_page(size_t page_index)
+{
+    // Pages only come back in while the owner is changing its memory, which keeps eviction away
+    // from the region while the copy is read back
+    auto* node = m_swap_entries.find(page_index);
+    ASSERT(node != nullptr);
+    u32 swap_entry = node->value();
+
+    auto physical_page = TRY_TAKE(MM.allocate_physical_user_page());
+    auto mapping = MM.temporary_map(physical_page);
+    if (mapping.is_error()) {
+        MUST(MM.free_physical_user_page(physical_page));
+        return mapping.error();
+    }
+
+    auto result = MM.swap_in_page(swap_entry, static_cast<u8*>(mapping.value().ptr()));
+    MM.temporary_unmap(mapping.value());
+
+    if (result.is_error()) {
+        MUST(MM.free_physical_user_page(physical_page));
+        return result;
+    }
+
+    MM.free_swap_entry(swap_entry);
+
+    PM.enter_critical();
+    m_swap_entries.remove(m_swap_entries.find(page_index));
+    m_physical_pages.set_page(page_index, physical_page);
+    PM.exit_critical();
+    return Status::OK;
+}
+
+bool VirtualRegion::is_page_shared(PhysicalAddress physical_page)
+{
+    return !m_is_kernel_region && MM.physical_user_page_share_count(physical_page) > 1;
+}
+
+bool VirtualRegion::is_page_dirty(PhysicalAddress physical_page)
+{
+    auto* frame = MM.page_frame(physical_page);
+    return frame != nullptr && frame->has_flag(PageFrame::Dirty);
+}
+
+bool VirtualRegion::is_page_merged(PhysicalAddress physical_page)
+{
+    auto* frame = MM.page_frame(physical_page);
+    return frame != nullptr && frame->has_flag(PageFrame::Merged);
+}
+
+void VirtualRegion::add_page_mapping(PhysicalAddress physical_page)
+{
+    auto* frame = MM.page_frame(physical_page);
+    if (!m_is_kernel_region && frame != nullptr) {
+        frame->map_count++;
+    }
+}
+
+void VirtualRegion::remove_page_mapping(PhysicalAddress physical_page)
+{
+    auto* frame = MM.page_frame(physical_page);
+    if (!m_is_kernel_region && frame != nullptr && frame->map_count > 0) {
+        frame->map_count--;
+    }
+}
+
+Result VirtualRegion::handle_zero_fault(size_t page_index)
+{
+    auto page_virtual_address = lower().offset(page_index * Memory::kPageSize);
+    auto& page_table_entry = MM.get_page_table_entry(*m_page_directory, page_virtual_address, !m_is_kernel_region);
+    auto physical_page = TRY_TAKE(MM.allocate_zeroed_physical_user_page());
+
+    m_physical_pages.set_page(page_index, physical_page);
+    add_page_mapping(physical_page);
+
+    page_table_entry.set_physical_page_base(physical_page.get());
+    page_table_entry.set_user(!m_is_kernel_region);
+    page_table_entry.set_global(m_is_kernel_region);
+    page_table_entry.set_present(true);
+    page_table_entry.set_read_write(is_writable());
+    Memory::invalidate_page(page_virtual_address);
+    return Status::OK;
 }
 
-Result VirtualRegion::copy(const VirtualRegion& dest)
+Result VirtualRegion::handle_vm_object_fault(size_t page_index, const PageFault& fault)
 {
-    for (size_t i = 0; i < m_physical_pages.size(); i++) {
-        auto* p = TRY_TAKE(MM.temporary_map(dest.physical_pages()[i])).ptr();
-        memcpy(p, lower().ptr() + Memory::kPageSize * i, Memory::kPageSize);
-        MM.temporary_unmap();
+    auto page_virtual_address = lower().offset(page_index * Memory::kPageSize);
+    auto physical_page = TRY_TAKE(m_vm_object->get_page(m_vm_object_page_offset + page_index));
+    TRY(MM.share_physical_user_page(physical_page));
+
+    m_physical_pages.set_page(page_index, physical_page);
+    add_page_mapping(physical_page);
+
+    // Shared mappings write straight into the object, private ones map it read only and copy on write
+    bool is_shared_write = m_is_shared && fault.is_write();
+    if (is_shared_write) {
+        MM.page_frame(physical_page)->set_flag(PageFrame::Dirty, true);
     }
 
+    auto& page_table_entry = MM.get_page_table_entry(*m_page_directory, page_virtual_address, !m_is_kernel_region);
+    page_table_entry.set_physical_page_base(physical_page.get());
+    page_table_entry.set_user(!m_is_kernel_region);
+    page_table_entry.set_present(true);
+    // Private mappings stay read only even when a shared one already dirtied the page, or their
+    // writes would land in the page cache
+    page_table_entry.set_read_write(is_writable() && m_is_shared && (is_shared_write || is_page_dirty(physical_page)));
+    Memory::invalidate_page(page_virtual_address);
+
+    if (fault.is_write() && !m_is_shared) {
+        return handle_copy_on_write_fault(page_index);
+    }
+    return Status::OK;
+}
+
+Result VirtualRegion::handle_copy_on_write_fault(size_t page_index)
+{
+    auto page_virtual_address = lower().offset(page_index * Memory::kPageSize);
+    auto& page_table_entry = MM.get_page_table_entry(*m_page_directory, page_virtual_address, !m_is_kernel_region);
+
+    auto physical_page = m_physical_pages.page(page_index);
+
+    // The last sharer takes ownership of the page without copying it
+    if (!m_is_shared && is_page_shared(physical_page)) {
+        auto new_physical_page = TRY_TAKE(MM.allocate_physical_user_page());
+        auto temporary_mapping = MM.temporary_map(new_physical_page);
+        if (temporary_mapping.is_error()) {
+            MM.free_physical_user_page(new_physical_page);
+            return temporary_mapping.error();
+        }
+
+        memcpy(temporary_mapping.value().ptr(), page_virtual_address.ptr(), Memory::kPageSize);
+        MM.temporary_unmap(temporary_mapping.value());
+
+        remove_page_mapping(physical_page);
+        TRY(MM.free_physical_user_page(physical_page));
+        physical_page = new_physical_page;
+        m_physical_pages.set_page(page_index, physical_page);
+        add_page_mapping(physical_page);
+        page_table_entry.set_physical_page_base(physical_page.get());
+    }
+
+    if (m_is_shared) {
+        MM.page_frame(physical_page)->set_flag(PageFrame::Dirty, true);
+    }
+
+    // The last sharer of a merged page owns it again and is about to change it
+    MM.page_frame(physical_page)->set_flag(PageFrame::Merged, false);
+
+    page_table_entry.set_read_write(true);
+    Memory::invalidate_page(page_virtual_address);
     return Status::OK;
 }
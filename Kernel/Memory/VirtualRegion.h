@@ -7,14 +7,22 @@
 #pragma once
 
 #include <Kernel/Memory/AddressAllocator.h>
+#include <Kernel/Memory/PageFault.h>
 #include <Kernel/Memory/Paging.h>
-#include <Universal/Array.h>
+#include <Kernel/Memory/PhysicalExtentList.h>
+#include <Kernel/Memory/VMObject.h>
 #include <Universal/LinkedList.h>
 #include <Universal/Number.h>
+#include <Universal/RedBlackTree.h>
 #include <Universal/UniquePtr.h>
 
+class Process;
+
 class VirtualRegion : public LinkedListNode<VirtualRegion> {
 public:
+    // Pages faulted in past the faulting one when the region is read sequentially
+    static constexpr size_t kSequentialReadAheadPages = 8;
+
     VirtualRegion(const AddressRange&, u8 access, bool is_kernel_region);
     ~VirtualRegion();
 
@@ -22,23 +30,78 @@ public:
     static UniquePtr<VirtualRegion> create_kernel_dma_region(const AddressRange& address_range, u8 access);
     static UniquePtr<VirtualRegion> create_kernel_region_at(PhysicalAddress, const AddressRange& address_range, u8 access);
 
-    static UniquePtr<VirtualRegion> create_user_region(const AddressRange& address_range, u8 access);
-
     enum Access {
         Read = 1,
         Write = 2,
         Execute = 4,
     };
 
+    enum AllocationStrategy {
+        Eager,
+        Lazy,
+    };
+
+    enum Sharing {
+        Private,
+        Shared,
+    };
+
+    enum AccessPattern {
+        Normal,
+        Sequential,
+    };
+
+    static UniquePtr<VirtualRegion> create_user_region(const AddressRange& address_range, u8 access, AllocationStrategy = Eager);
+    static UniquePtr<VirtualRegion> create_user_region(const AddressRange& address_range, u8 access, SharedPtr<VMObject>, size_t vm_object_page_offset, Sharing);
+    // Backed by zeroed large pages up front, returns null when no aligned physical memory is left
+    static UniquePtr<VirtualRegion> create_user_huge_region(const AddressRange& address_range, u8 access);
+
+    UniquePtr<VirtualRegion> clone();
+
     const AddressRange& address_range() const { return m_address_range; }
 
     void map(PageDirectory&);
+    void map_pages(PageDirectory&, size_t first_page, size_t count);
     Result unmap(PageDirectory&);
     Result free();
+    void resize(size_t length);
+    UniquePtr<VirtualRegion> split(size_t page_index);
+    void move_to(VirtualAddress);
+
+    // Backs and maps every page in the range that is not resident yet
+    Result populate(size_t first_page, size_t count);
+    // Drops the pages so the next touch sees zeros, or the memory object's contents again
+    void discard(size_t first_page, size_t count);
+
+    void set_access_pattern(AccessPattern access_pattern) { m_access_pattern = access_pattern; }
     bool contains(VirtualAddress);
     bool is_accessible(VirtualAddress, size_t);
 
-    Result copy(const VirtualRegion&);
+    Result handle_fault(const PageFault&);
+
+    // Only private anonymous pages can be swapped, everything else has another copy or is shared
+    bool can_swap_out() const { return !m_is_kernel_region && !m_is_huge && m_vm_object.is_null() && !m_page_directory.is_null(); }
+    // A page the CLOCK sweep picked for eviction. Its entry is cleared while it is written out
+    // and the owner's next memory change waits until the page out is finished.
+    struct PageOut {
+        VirtualRegion* region { nullptr };
+        size_t page_index { 0 };
+        PhysicalAddress physical_page;
+        PageTableEntry* page_table_entry { nullptr };
+        PageTableEntry saved_page_table_entry;
+    };
+
+    // One step of the CLOCK sweep. A page used since the last sweep loses its accessed bit and
+    // gets another chance, one that was not is picked for eviction. Returns whether it was.
+    // Both are called inside a critical section, the write to swap happens in between.
+    bool sweep_page(size_t page_index, PageOut&);
+    // Moves the page to its swap entry, or maps it again when it could not be written out
+    void finish_page_out(const PageOut&, const Expected<u32>& swap_entry);
+
+    // Private anonymous pages can also be merged with identical pages elsewhere
+    bool can_merge() const { return can_swap_out() && !m_is_shared; }
+    // Maps the page to an identical merged frame if there is one. Returns whether it was.
+    bool merge_page(size_t page_index);
 
     inline size_t page_count() { return ceiling_divide(m_address_range.length(), Memory::kPageSize); }
 
@@ -46,22 +109,61 @@ public:
     inline bool is_readable() const { return m_access & Read; }
     inline bool is_writable() const { return m_access & Write; }
     inline bool is_executable() const { return m_access & Execute; }
+    inline bool is_shared() const { return m_is_shared; }
+    inline bool is_huge() const { return m_is_huge; }
+
+    // The process the region is mapped into, null while it is not part of one yet
+    Process* owner() const { return m_owner; }
+    void set_owner(Process* owner) { m_owner = owner; }
+
+    VMObject* vm_object() { return m_vm_object.ptr(); }
+    size_t vm_object_page_offset() const { return m_vm_object_page_offset; }
 
     size_t length() const { return m_address_range.length(); }
     VirtualAddress lower() const { return m_address_range.lower(); }
     VirtualAddress upper() const { return m_address_range.upper(); }
 
-    const Array<PhysicalAddress>& physical_pages() const { return m_physical_pages; }
+    const PhysicalExtentList& physical_pages() const { return m_physical_pages; }
+    PhysicalAddress physical_page(size_t page_index) const { return m_physical_pages.page(page_index); }
 
     VirtualRegion* m_next { nullptr };
     VirtualRegion* m_previous { nullptr };
 
 private:
+    bool is_page_backed(size_t page_index) const { return m_physical_pages.is_backed(page_index); }
+    bool is_page_shared(PhysicalAddress);
+    bool is_page_dirty(PhysicalAddress);
+    bool is_page_merged(PhysicalAddress);
+
+    void add_page_mapping(PhysicalAddress);
+    void remove_page_mapping(PhysicalAddress);
+    void release_pages(size_t first_page, size_t count);
+    size_t large_page_count() const { return m_address_range.length() / Memory::kLargePageSize; }
+    void map_large_pages(PageDirectory&);
+    void copy_from(VirtualRegion&);
+
+    Result handle_zero_fault(size_t page_index);
+    Result handle_vm_object_fault(size_t page_index, const PageFault&);
+    Result handle_copy_on_write_fault(size_t page_index);
+
+    bool is_page_swapped(size_t page_index) const { return m_swap_entries.find(page_index) != nullptr; }
+    Result swap_in_page(size_t page_index);
+    void release_swap_entries(size_t first_page, size_t count);
+
     AddressRange m_address_range;
 
-    Array<PhysicalAddress> m_physical_pages;
+    PhysicalExtentList m_physical_pages;
+    // Where the pages that were evicted went, by page index
+    RedBlackTree<size_t, u32> m_swap_entries;
     SharedPtr<PageDirectory> m_page_directory;
+    Process* m_owner { nullptr };
+
+    SharedPtr<VMObject> m_vm_object;
+    size_t m_vm_object_page_offset { 0 };
+    bool m_is_shared { false };
 
     u8 m_access { Read };
     bool m_is_kernel_region { false };
+    AccessPattern m_access_pattern { Normal };
+    bool m_is_huge { false };
 };
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2025, Jason Long <jasonlongball@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <Kernel/Memory/Address.h>
+#include <Universal/Assert.h>
+#include <Universal/Expected.h>
+#include <Universal/Types.h>
+
+// A stack of physical pages that are already known to be zero. The idle process keeps it
+// topped up so that allocations needing zeroed memory rarely have to clear a page themselves.
+template<size_t Capacity>
+class ZeroedPagePool {
+public:
+    bool is_empty() const { return m_size == 0; }
+    bool is_full() const { return m_size == Capacity; }
+
+    size_t size() const { return m_size; }
+    size_t capacity() const { return Capacity; }
+    size_t hits() const { return m_hits; }
+    size_t misses() const { return m_misses; }
+
+    PhysicalAddress operator[](size_t index) const { return m_pages[index]; }
+
+    Expected<PhysicalAddress> take()
+    {
+        if (is_empty()) {
+            m_misses++;
+            return Result(Status::Failure);
+        }
+
+        m_hits++;
+        return m_pages[--m_size];
+    }
+
+    void add(PhysicalAddress page)
+    {
+        ASSERT(!is_full());
+        m_pages[m_size++] = page;
+    }
+
+private:
+    PhysicalAddress m_pages[Capacity];
+    size_t m_size { 0 };
+    size_t m_hits { 0 };
+    size_t m_misses { 0 };
+};
@@ -228,8 +228,8 @@ void E1000NetworkCard::rx_init()
     m_rx_buffer_region = MM.allocate_kernel_dma_region(E1000_RX_BUFFER_SIZE * E1000_NUM_RX_DESC);
     ASSERT((m_rx_desc_region->lower() % 16) == 0);
 
-    u32 physical_desc_start = m_rx_desc_region->physical_pages()[0].get();
-    u32 physical_buffer_start = m_rx_buffer_region->physical_pages()[0].get();
+    u32 physical_desc_start = m_rx_desc_region->physical_page(0).get();
+    u32 physical_buffer_start = m_rx_buffer_region->physical_page(0).get();
     auto descs = rx_descs_base();
     for (u32 i = 0; i < E1000_NUM_RX_DESC; i++) {
         descs[i].addr = physical_buffer_start + (E1000_RX_BUFFER_SIZE * i);
@@ -253,8 +253,8 @@ void E1000NetworkCard::tx_init()
     m_tx_buffer_region = MM.allocate_kernel_dma_region(E1000_TX_BUFFER_SIZE * E1000_NUM_TX_DESC);
     ASSERT((m_tx_desc_region->lower() % 16) == 0);
 
-    u32 physical_desc_start = m_tx_desc_region->physical_pages()[0].get();
-    u32 physical_buffer_start = m_tx_buffer_region->physical_pages()[0].get();
+    u32 physical_desc_start = m_tx_desc_region->physical_page(0).get();
+    u32 physical_buffer_start = m_tx_buffer_region->physical_page(0).get();
     auto descs = tx_descs_base();
     for (u32 i = 0; i < E1000_NUM_TX_DESC; i++) {
         descs[i].addr = physical_buffer_start + (E1000_TX_BUFFER_SIZE * i);
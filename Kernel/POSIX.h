@@ -126,10 +126,19 @@ struct stat {
 #define MAP_FIXED 0x04
 #define MAP_ANONYMOUS 0x08
 #define MAP_ANON MAP_ANONYMOUS
+#define MAP_POPULATE 0x10
+#define MAP_HUGETLB 0x20
 
 #define PROT_NONE 0x00
 #define PROT_READ 0x01
 #define PROT_WRITE 0x02
 #define PROT_EXEC 0x04
 
+#define MREMAP_MAYMOVE 0x01
+
+#define MADV_NORMAL 0
+#define MADV_SEQUENTIAL 2
+#define MADV_WILLNEED 3
+#define MADV_DONTNEED 4
+
 #define MAP_FAILED ((void*)-1)
@@ -9,6 +9,7 @@
 #include <Kernel/DebugConsole.h>
 #include <Kernel/Filesystem/VFS.h>
 #include <Kernel/Memory/MemoryManager.h>
+#include <Kernel/Memory/UserCopy.h>
 #include <Kernel/POSIX.h>
 #include <Kernel/Process/ELF.h>
 #include <Kernel/Process/Process.h>
@@ -33,14 +34,7 @@ Process::Process(StringView name, pid_t pid, pid_t ppid, bool is_kernel, Directo
     if (is_kernel) {
         m_page_directory = MM.kernel_page_directory();
     } else {
-        m_page_directory = PageDirectory::create_user_page_directory();
-        m_page_directory->set_base(MM.allocate_physical_kernel_page());
-
-        // Copy Kernel identity map and higher-half
-        m_page_directory->entries()[0].copy(MM.kernel_page_directory().entries()[0]);
-        for (u32 page = 768; page < 1024; page++) {
-            m_page_directory->entries()[page].copy(MM.kernel_page_directory().entries()[page]);
-        }
+        m_page_directory = MM.create_user_page_directory();
     }
 
     reset_timer_ticks();
@@ -66,14 +60,7 @@ Process::Process(const Process& parent)
         panic("Kernel processes may not be forked\n");
     }
 
-    m_page_directory = PageDirectory::create_user_page_directory();
-    m_page_directory->set_base(MM.allocate_physical_kernel_page());
-
-    // Copy Kernel identity map and higher-half
-    m_page_directory->entries()[0].copy(MM.kernel_page_directory().entries()[0]);
-    for (u32 page = 768; page < 1024; page++) {
-        m_page_directory->entries()[page].copy(MM.kernel_page_directory().entries()[page]);
-    }
+    m_page_directory = MM.create_user_page_directory();
 
     for (size_t i = 0; i < parent.m_fds.size(); i++) {
         if (parent.m_fds[i].ptr() == nullptr) {
@@ -87,8 +74,8 @@ Process::~Process()
 {
     // TODO: Manually deleting this right now because storing UniquePtr in
     // ArrayList does not currently work
-    for (size_t i = 0; i < m_regions.size(); i++) {
-        delete m_regions[i];
+    for (auto* node = m_regions.first(); node != nullptr; node = RegionTree::next(node)) {
+        delete node->value();
     }
 }
 
@@ -124,6 +111,9 @@ Expected<Process*> Process::create_user_process(StringView path, pid_t pid, pid_
     }
     auto process = new Process(path, pid, ppid, false, cwd, tty);
 
+    // Nothing may be evicted from the process until its image and stack are all in place
+    process->begin_memory_change();
+
     argv.add_first(path);
 
     u32 entry_point = TRY_TAKE(process->load_elf());
@@ -141,6 +131,7 @@ Expected<Process*> Process::create_user_process(StringView path, pid_t pid, pid_
     regs.segment.gs = CPU::SegmentSelector(CPU::Ring3, 4);
     TRY(process->initialize_kernel_stack(regs));
 
+    process->end_memory_change();
     PM.add_process(*process);
 
     dbgprintf("Process", "User Process '%s' (%u) spawned\n", process->m_name.data(), process->m_pid);
@@ -150,57 +141,182 @@ Expected<Process*> Process::create_user_process(StringView path, pid_t pid, pid_
 Expected<Process*> Process::fork_user_process(Process& parent, TaskRegisters& regs)
 {
     auto child = new Process(parent);
+    child->begin_memory_change();
 
     regs.general_purpose.eax = 0;
     TRY(child->initialize_kernel_stack(regs));
 
-    for (size_t i = 0; i < parent.m_regions.size(); i++) {
-        TRY_TAKE(child->allocate_region_at(parent.m_regions[i]->lower(), parent.m_regions[i]->length(), parent.m_regions[i]->access()));
-        parent.m_regions[i]->copy(*child->m_regions[i]);
+    // Parent and child share every page copy-on-write until one of them writes
+    for (auto* node = parent.m_regions.first(); node != nullptr; node = RegionTree::next(node)) {
+        TRY_TAKE(child->clone_region(*node->value()));
     }
 
-    // For now the user stack will always be the first region
-    child->m_user_stack = child->m_regions[0];
+    child->m_user_stack = child->find_region(parent.m_user_stack->lower());
 
+    // The heap region was cloned with the others, the rest of its reservation still has to be kept free
+    child->m_heap_reservation = parent.m_heap_reservation;
+    child->m_break = parent.m_break;
+    if (parent.m_heap_reservation.length() > 0) {
+        VirtualAddress heap_upper = parent.m_heap_reservation.lower();
+        if (parent.m_heap != nullptr) {
+            child->m_heap = child->find_region(parent.m_heap->lower());
+            heap_upper = parent.m_heap->upper();
+        }
+
+        if (heap_upper < parent.m_heap_reservation.upper()) {
+            TRY_TAKE(child->page_directory().address_allocator().allocate_at(heap_upper, parent.m_heap_reservation.upper() - heap_upper));
+        }
+    }
+
+    child->end_memory_change();
     PM.add_process(*child);
 
     dbgprintf("Process", "User Process '%s' (%u) forked to spawn %u\n", parent.m_name.data(), parent.m_pid, child->m_pid);
     return child;
 }
 
-Expected<VirtualRegion*> Process::allocate_region(size_t size, u8 access)
+void Process::begin_memory_change()
+{
+    // Checked and counted in one go, eviction only starts writing a page out while the owner
+    // is not changing its memory
+    while (true) {
+        {
+            CPU::InterruptDisabler interrupt_disabler;
+            if (m_page_outs == 0) {
+                m_memory_changes++;
+                return;
+            }
+        }
+        PM.yield();
+    }
+}
+
+Expected<VirtualRegion*> Process::allocate_region(size_t size, u8 access, VirtualRegion::AllocationStrategy allocation_strategy)
+{
+    return allocate_region_at(VirtualAddress(), size, access, allocation_strategy);
+}
+
+Expected<VirtualRegion*> Process::allocate_region_at(VirtualAddress virtual_address, size_t size, u8 access, VirtualRegion::AllocationStrategy allocation_strategy)
+{
+    auto range = TRY_TAKE(allocate_address_range(virtual_address, size));
+
+    auto region = VirtualRegion::create_user_region(range, access, allocation_strategy);
+    if (region.ptr() == nullptr) {
+        MUST(page_directory().address_allocator().free(range));
+        return Result(Status::Failure);
+    }
+    return add_region(move(region));
+}
+
+Expected<VirtualRegion*> Process::allocate_huge_region(size_t size, u8 access)
 {
-    return allocate_region_at(VirtualAddress(), size, access);
+    // Both the virtual and physical ranges have to line up with a page directory entry
+    size_t length = ceiling_divide(size, Memory::kLargePageSize) * Memory::kLargePageSize;
+    auto range = TRY_TAKE(page_directory().address_allocator().allocate_aligned(length, Memory::kLargePageSize));
+
+    auto region = VirtualRegion::create_user_huge_region(range, access);
+    if (region.ptr() == nullptr) {
+        MUST(page_directory().address_allocator().free(range));
+        return Result(Status::Failure);
+    }
+    return add_region(move(region));
 }
 
-Expected<VirtualRegion*> Process::allocate_region_at(VirtualAddress virtual_address, size_t size, u8 access)
+Expected<VirtualRegion*> Process::allocate_vm_object_region_at(VirtualAddress virtual_address, size_t size, u8 access, SharedPtr<VMObject> vm_object, size_t vm_object_page_offset, VirtualRegion::Sharing sharing)
+{
+    auto range = TRY_TAKE(allocate_address_range(virtual_address, size));
+    return add_region(VirtualRegion::create_user_region(range, access, move(vm_object), vm_object_page_offset, sharing));
+}
+
+Expected<AddressRange> Process::allocate_address_range(VirtualAddress virtual_address, size_t size)
 {
-    AddressRange range;
     if (virtual_address.is_null()) {
-        range = TRY_TAKE(page_directory().address_allocator().allocate(size));
-    } else {
-        range = TRY_TAKE(page_directory().address_allocator().allocate_at(virtual_address, size));
+        return page_directory().address_allocator().allocate(size);
+    }
+    return page_directory().address_allocator().allocate_at(virtual_address, size);
+}
+
+VirtualRegion* Process::add_region(UniquePtr<VirtualRegion>&& region)
+{
+    auto* added_region = region.leak_ptr();
+    ASSERT(m_regions.insert(added_region->lower().get(), added_region) != nullptr);
+    added_region->set_owner(this);
+    added_region->map(page_directory());
+
+    dbgprintf_if(DEBUG_PROCESS, "Process", "Allocated virtual region 0x%x - 0x%x for Process '%s'\n", added_region->lower(), added_region->upper(), name().data());
+
+    return added_region;
+}
+
+void Process::remove_region(VirtualRegion& region)
+{
+    auto* node = m_regions.find(region.lower().get());
+    ASSERT(node != nullptr && node->value() == &region);
+    m_regions.remove(node);
+
+    if (m_last_found_region == &region) {
+        m_last_found_region = nullptr;
+    }
+}
+
+Expected<VirtualRegion*> Process::clone_region(VirtualRegion& region)
+{
+    TRY_TAKE(page_directory().address_allocator().allocate_at(region.lower(), region.length()));
+
+    auto clone = region.clone();
+    if (clone.ptr() == nullptr) {
+        MUST(page_directory().address_allocator().free(region.address_range()));
+        return Result(Status::Failure);
     }
 
-    m_regions.add_last(VirtualRegion::create_user_region(range, access).leak_ptr());
-    m_regions.last()->map(page_directory());
+    auto* cloned_region = clone.leak_ptr();
+    ASSERT(m_regions.insert(cloned_region->lower().get(), cloned_region) != nullptr);
+    cloned_region->set_owner(this);
+    cloned_region->map(page_directory());
 
-    dbgprintf_if(DEBUG_PROCESS, "Process", "Allocated virtual region 0x%x - 0x%x for Process '%s'\n", m_regions.last()->lower(), m_regions.last()->upper(), name().data());
+    dbgprintf_if(DEBUG_PROCESS, "Process", "Cloned virtual region 0x%x - 0x%x for Process '%s'\n", cloned_region->lower(), cloned_region->upper(), name().data());
 
-    return m_regions.last();
+    return cloned_region;
 }
 
-Result Process::deallocate_region(size_t index)
+Result Process::deallocate_region(VirtualRegion& region)
 {
-    if (index < 0 || index > m_regions.size()) {
+    dbgprintf_if(DEBUG_PROCESS, "Process", "Deallocating virtual region 0x%x - 0x%x for Process '%s'\n", region.lower(), region.upper(), name().data());
+
+    TRY(region.unmap(page_directory()));
+    TRY(page_directory().address_allocator().free(region.address_range()));
+    TRY(region.free());
+    return Status::OK;
+}
+
+Result Process::set_break(VirtualAddress new_break)
+{
+    if (m_heap_reservation.length() == 0) {
+        m_heap_reservation = TRY_TAKE(page_directory().address_allocator().allocate(kUserHeapMaxLength));
+        m_break = m_heap_reservation.lower();
+    }
+
+    if (new_break < m_heap_reservation.lower() || new_break > m_heap_reservation.upper()) {
         return Status::Failure;
     }
 
-    dbgprintf_if(DEBUG_PROCESS, "Process", "Deallocating virtual region 0x%x - 0x%x for Process '%s'\n", m_regions[index]->lower(), m_regions[index]->upper(), name().data());
+    // The reservation stays allocated, so the heap's pages are returned without freeing its range
+    size_t heap_length = Memory::page_round_up(new_break - m_heap_reservation.lower());
+    if (heap_length == 0 && m_heap != nullptr) {
+        TRY(m_heap->unmap(page_directory()));
+        TRY(m_heap->free());
+        remove_region(*m_heap);
+        delete m_heap;
+        m_heap = nullptr;
+    } else if (heap_length > 0 && m_heap == nullptr) {
+        m_heap = add_region(VirtualRegion::create_user_region(AddressRange(m_heap_reservation.lower(), heap_length), VirtualRegion::Read | VirtualRegion::Write, VirtualRegion::Lazy));
+    } else if (heap_length > 0) {
+        m_heap->resize(heap_length);
+    }
+
+    dbgprintf_if(DEBUG_PROCESS, "Process", "Moved the break of Process '%s' from 0x%x to 0x%x\n", name().data(), m_break, new_break);
 
-    TRY(m_regions[index]->unmap(page_directory()));
-    TRY(page_directory().address_allocator().free(m_regions[index]->address_range()));
-    TRY(m_regions[index]->free());
+    m_break = new_break;
     return Status::OK;
 }
 
@@ -261,7 +377,7 @@ Result Process::initialize_kernel_stack(const TaskRegisters& regs)
 Expected<u32> Process::initialize_user_stack(ArrayList<StringView>&& argv)
 {
     m_user_stack = TRY_TAKE(allocate_region(kUserStackSize, VirtualRegion::Read | VirtualRegion::Write));
-    auto temporary_mapping = TRY_TAKE(MM.temporary_map(m_user_stack->physical_pages()[m_user_stack->physical_pages().size() - 1]));
+    auto temporary_mapping = TRY_TAKE(MM.temporary_map(m_user_stack->physical_page(m_user_stack->page_count() - 1)));
 
     const u32 capacity = Memory::kPageSize / sizeof(u32);
     u32* stack = reinterpret_cast<u32*>(temporary_mapping.ptr());
@@ -301,7 +417,7 @@ Expected<u32> Process::initialize_user_stack(ArrayList<StringView>&& argv)
     *(stack_after_args--) = temporary_address_to_user_address((u32)stack_argv);
     *(stack_after_args--) = argv.size();
 
-    MM.temporary_unmap();
+    MM.temporary_unmap(temporary_mapping);
     return temporary_address_to_user_address(reinterpret_cast<u32>(stack_after_args));
 }
 
@@ -315,16 +431,32 @@ Expected<u32> Process::load_elf()
         auto program_header = elf_program_headers[i];
         if (program_header.p_type == PT_LOAD) {
             size_t load_location = Memory::page_round_down(program_header.p_vaddr);
-            size_t load_memory_size = Memory::page_round_up(program_header.p_memsz);
+            size_t load_memory_size = Memory::page_round_up(program_header.p_vaddr + program_header.p_memsz) - load_location;
 
             auto region = TRY_TAKE(allocate_region_at(load_location, load_memory_size, ELF::program_flags_to_access(program_header.p_flags)));
 
-            // TODO: Find a faster way to do this
-            auto tmp_kernel_region = MM.allocate_kernel_region_at(region->physical_pages().first(), load_memory_size);
-            fd->seek(program_header.p_offset, SEEK_SET);
-            fd->read(tmp_kernel_region->lower().ptr(), program_header.p_filesz);
-
-            MM.free_kernel_region(*tmp_kernel_region);
+            // Read the segment straight into its pages, mapping a few of them at a time
+            size_t segment_offset = program_header.p_vaddr - load_location;
+            size_t bytes_read = 0;
+            for (size_t page = 0; bytes_read < program_header.p_filesz; page += kElfLoadBatchPages) {
+                size_t page_count = min(kElfLoadBatchPages, region->page_count() - page);
+                PhysicalAddress physical_pages[kElfLoadBatchPages];
+                for (size_t j = 0; j < page_count; j++) {
+                    physical_pages[j] = region->physical_page(page + j);
+                }
+                auto mapping = TRY_TAKE(MM.temporary_map(physical_pages, page_count));
+
+                size_t start = page == 0 ? segment_offset : 0;
+                size_t length = min(program_header.p_filesz - bytes_read, page_count * Memory::kPageSize - start);
+                fd->seek(program_header.p_offset + bytes_read, SEEK_SET);
+                ssize_t result = fd->read(mapping.offset(start).ptr(), length);
+                MM.temporary_unmap(mapping, page_count);
+
+                if (result < 0 || (size_t)result != length) {
+                    return Result(Status::Failure);
+                }
+                bytes_read += length;
+            }
         }
     }
 
@@ -384,6 +516,11 @@ void Process::reap()
     m_pid = 0;
     m_ppid = 0;
     MM.free_kernel_region(*m_kernel_stack);
+
+    // Nothing runs on this address space anymore, so its page tables can go too
+    if (!m_is_kernel) {
+        MM.free_user_page_directory(*m_page_directory);
+    }
     PM.remove_process(*this);
 }
 
@@ -395,19 +532,43 @@ DirectoryEntry& Process::working_directory()
     return *m_cwd;
 }
 
-bool Process::is_address_accessible(const void* address, size_t length)
+VirtualRegion* Process::find_region(VirtualAddress address)
 {
-    for (int i = 0; i < m_regions.size(); i++) {
-        if (m_regions[i]->is_accessible((u32)address, length)) {
-            return true;
-        }
+    if (m_last_found_region != nullptr && m_last_found_region->contains(address)) {
+        return m_last_found_region;
+    }
+
+    // Regions never overlap, so only the closest one starting at or below the address can contain it
+    auto* node = m_regions.find_largest_not_above(address.get());
+    if (node == nullptr || !node->value()->contains(address)) {
+        return nullptr;
+    }
+
+    m_last_found_region = node->value();
+    return m_last_found_region;
+}
+
+VirtualRegion* Process::find_region_from(VirtualAddress address)
+{
+    auto* region = find_region(address);
+    if (region != nullptr) {
+        return region;
     }
-    return false;
+
+    auto* node = m_regions.find_smallest_not_below(address.get());
+    return node != nullptr ? node->value() : nullptr;
 }
 
-bool Process::is_string_accessible(StringView str)
+bool Process::is_address_accessible(const void* address, size_t length)
 {
-    return is_address_accessible(str.str(), str.length() + 1);
+    auto* region = find_region((u32)address);
+    return region != nullptr && region->is_accessible((u32)address, length);
+}
+
+bool Process::is_string_accessible(const char* str)
+{
+    auto length = strnlen_from_user(str, kMaxStringLength);
+    return length.is_ok() && is_address_accessible(str, length.value() + 1);
 }
 
 int Process::next_file_descriptor()
@@ -433,16 +594,28 @@ Expected<SharedPtr<FileDescriptor>> Process::find_file_descriptor(int fd)
 
 void Process::die()
 {
-    for (int i = 0; i < m_regions.size(); i++) {
-        deallocate_region(i);
+    for (auto* node = m_regions.first(); node != nullptr; node = RegionTree::next(node)) {
+        deallocate_region(*node->value());
     }
 
     m_state = Process::Dead;
 }
 
-int Process::sys_chdir(const char* path)
+void* Process::sys_brk(void* addr)
+{
+    // Like Linux, asking for a break that cannot be set returns the current one
+    if (addr != nullptr) {
+        (void)set_break(reinterpret_cast<u32>(addr));
+    } else if (set_break(m_break).is_error()) {
+        return (void*)-ENOMEM;
+    }
+    return m_break.ptr();
+}
+
+int Process::sys_chdir(const char* user_path)
 {
-    if (!is_string_accessible(path)) {
+    char path[kMaxPathLength];
+    if (strncpy_from_user(path, user_path, sizeof(path)).is_error()) {
         return -EFAULT;
     }
 
@@ -452,17 +625,39 @@ int Process::sys_chdir(const char* path)
 
 int Process::sys_dbgwrite(const char* buf, size_t length)
 {
-    DebugConsole::the().write(buf, length);
+    char chunk[128];
+    for (size_t written = 0; written < length; written += sizeof(chunk)) {
+        size_t chunk_length = min(sizeof(chunk), length - written);
+        if (copy_from_user(chunk, buf + written, chunk_length).is_error()) {
+            return -EFAULT;
+        }
+        DebugConsole::the().write(chunk, chunk_length);
+    }
     return 0;
 }
 
-int Process::sys_execve(const char* pathname, char* const* argv)
+int Process::sys_execve(const char* user_pathname, char* const* argv)
 {
+    char pathname[kMaxPathLength];
+    if (strncpy_from_user(pathname, user_pathname, sizeof(pathname)).is_error()) {
+        return -EFAULT;
+    }
+
     int ret;
     {
         ArrayList<StringView> arguments;
-        for (size_t i = 0; argv[i]; ++i) {
-            arguments.add_last(argv[i]);
+        for (size_t i = 0;; ++i) {
+            char* argument;
+            if (copy_from_user(&argument, &argv[i], sizeof(argument)).is_error()) {
+                return -EFAULT;
+            }
+            if (argument == nullptr) {
+                break;
+            }
+            if (!is_string_accessible(argument)) {
+                return -EFAULT;
+            }
+            arguments.add_last(argument);
         }
 
         auto execve_result = Process::create_user_process(pathname, m_pid, m_ppid, move(arguments), m_cwd.ptr(), m_tty.ptr());
@@ -482,6 +677,13 @@ int Process::sys_execve(const char* pathname, char* const* argv)
     return ret;
 }
 
+void Process::crash()
+{
+    dbgprintf("Process", "'%s' (%u) crashed\n", m_name.data(), m_pid);
+    begin_memory_change();
+    die();
+}
+
 void Process::sys_exit(int status)
 {
     dbgprintf("Process", "'%s' (%u) exited with status %d\n", m_name.data(), m_pid, status);
@@ -499,34 +701,36 @@ pid_t Process::sys_fork(TaskRegisters& regs)
     return child->pid();
 }
 
-int Process::sys_fstat(int fd, stat* statbuf)
+int Process::sys_fstat(int fd, stat* user_statbuf)
 {
-    if (!is_address_accessible(statbuf, sizeof(stat))) {
-        return -EFAULT;
-    }
-
     auto fd_result = find_file_descriptor(fd);
     if (fd_result.is_error()) {
         return -EBADF;
     }
 
-    return fd_result.release_value()->fstat(*statbuf);
-}
+    stat statbuf = {};
+    int result = fd_result.release_value()->fstat(statbuf);
+    if (result < 0) {
+        return result;
+    }
 
-int Process::sys_getcwd(char* buf, size_t size)
-{
-    if (!is_address_accessible(buf, size)) {
+    if (copy_to_user(user_statbuf, &statbuf, sizeof(statbuf)).is_error()) {
         return -EFAULT;
     }
+    return result;
+}
 
+int Process::sys_getcwd(char* buf, size_t size)
+{
     String cwd = working_directory().absolute_path();
-    if (cwd.length() > size) {
+    if (cwd.length() + 1 > size) {
         return -ERANGE;
     }
 
-    size_t length = min(size, cwd.length());
-    memcpy(buf, cwd.data(), length);
-    buf[length] = '\0';
+    // Copies the terminator along with the path
+    if (copy_to_user(buf, cwd.data(), cwd.length() + 1).is_error()) {
+        return -EFAULT;
+    }
     return 0;
 }
 
@@ -582,13 +786,71 @@ int Process::sys_isatty(int fd)
     return fd_result.release_value()->file().is_tty_device();
 }
 
-void* Process::sys_mmap(const mmap_args* args)
+int Process::sys_madvise(void* addr, size_t length, int advice)
+{
+    VirtualAddress advice_address(reinterpret_cast<u32>(addr));
+    if (!Memory::is_page_aligned(advice_address) || length == 0 || !is_address_accessible(addr, length)) {
+        return -EINVAL;
+    }
+
+    VirtualRegion* region = find_region(advice_address);
+    size_t first_page = (advice_address - region->lower()) / Memory::kPageSize;
+    size_t page_count = ceiling_divide(length, Memory::kPageSize);
+
+    switch (advice) {
+        case MADV_NORMAL:
+        case MADV_SEQUENTIAL: {
+            // The pattern belongs to a whole region, so the advised pages are split off into their own
+            size_t end_page = first_page + page_count;
+            if (first_page != 0 || end_page < region->page_count()) {
+                if (region == m_heap || region->is_huge()) {
+                    return -EINVAL;
+                }
+                if (end_page < region->page_count()) {
+                    add_region(region->split(end_page));
+                }
+                if (first_page != 0) {
+                    region = add_region(region->split(first_page));
+                }
+            }
+            region->set_access_pattern(advice == MADV_SEQUENTIAL ? VirtualRegion::Sequential : VirtualRegion::Normal);
+            return 0;
+        }
+        case MADV_WILLNEED:
+            if (!region->is_readable()) {
+                return -EINVAL;
+            }
+            return region->populate(first_page, page_count).is_ok() ? 0 : -ENOMEM;
+        case MADV_DONTNEED:
+            if (region->is_huge()) {
+                return -EINVAL;
+            }
+            region->discard(first_page, page_count);
+            return 0;
+        default:
+            return -EINVAL;
+    }
+}
+
+int Process::sys_meminfo(meminfo* user_info)
+{
+    meminfo info = {};
+    MM.get_memory_statistics(info);
+
+    if (copy_to_user(user_info, &info, sizeof(info)).is_error()) {
+        return -EFAULT;
+    }
+    return 0;
+}
+
+void* Process::sys_mmap(const mmap_args* user_args)
 {
-    if (!is_address_accessible(args, sizeof(mmap_args))) {
+    mmap_args args;
+    if (copy_from_user(&args, user_args, sizeof(args)).is_error()) {
         return (void*)-EFAULT;
     }
 
-    auto& [addr, length, prot, flags, fd, offset] = *args;
+    auto& [addr, length, prot, flags, fd, offset] = args;
 
     if ((flags & MAP_SHARED && flags & MAP_PRIVATE) || (!(flags & MAP_SHARED) && !(flags & MAP_PRIVATE)) || length == 0) {
         return (void*)-EINVAL;
@@ -602,12 +864,55 @@ void* Process::sys_mmap(const mmap_args* args)
         return (void*)-ENOMEM;
     }
 
-    auto allocate_result = allocate_region(length, prot);
+    // Large pages are only handed out as private anonymous memory, backed as soon as they are mapped
+    if (flags & MAP_HUGETLB && (!(flags & MAP_ANONYMOUS) || flags & MAP_SHARED)) {
+        return (void*)-EINVAL;
+    }
+
+    Expected<VirtualRegion*> allocate_result = Result(Status::Failure);
+    if (flags & MAP_HUGETLB) {
+        allocate_result = allocate_huge_region(length, prot);
+    } else if (flags & MAP_ANONYMOUS) {
+        // Anonymous mappings are only backed once they are touched, shared ones through a common object
+        if (flags & MAP_SHARED) {
+            allocate_result = allocate_vm_object_region_at(VirtualAddress(), length, prot, VMObject::create_anonymous(ceiling_divide(length, Memory::kPageSize)), 0, VirtualRegion::Shared);
+        } else {
+            allocate_result = allocate_region(length, prot, VirtualRegion::Lazy);
+        }
+    } else {
+        if (!Memory::is_page_aligned(offset)) {
+            return (void*)-EINVAL;
+        }
+
+        auto fd_result = find_file_descriptor(fd);
+        if (fd_result.is_error()) {
+            return (void*)-EBADF;
+        }
+
+        auto vm_object_result = VMObject::find_or_create_for_file(*fd_result.value());
+        if (vm_object_result.is_error()) {
+            return (void*)-EINVAL;
+        }
+
+        // File pages are read from the page cache on first touch
+        auto sharing = flags & MAP_SHARED ? VirtualRegion::Shared : VirtualRegion::Private;
+        allocate_result = allocate_vm_object_region_at(VirtualAddress(), length, prot, vm_object_result.release_value(), offset / Memory::kPageSize, sharing);
+    }
+
     if (allocate_result.is_error()) {
         return (void*)-ENOMEM;
     }
 
-    return allocate_result.value()->lower().ptr();
+    // Fault the whole mapping in now so the first pass over it takes no faults
+    auto* region = allocate_result.value();
+    if (flags & MAP_POPULATE && region->is_readable() && region->populate(0, region->page_count()).is_error()) {
+        ASSERT(deallocate_region(*region).is_ok());
+        remove_region(*region);
+        delete region;
+        return (void*)-ENOMEM;
+    }
+
+    return region->lower().ptr();
 }
 
 int Process::sys_munmap(void* addr, size_t length)
@@ -617,49 +922,105 @@ int Process::sys_munmap(void* addr, size_t length)
         return -EINVAL;
     }
 
-    size_t i = 0;
-    for (; i < m_regions.size(); i++) {
-        if (m_regions[i]->contains(unmap_address)) {
-            break;
-        }
+    // The heap only changes size through brk, which keeps its address range reserved
+    VirtualRegion* old_region = find_region(unmap_address);
+    if (old_region == nullptr || old_region == m_heap) {
+        return -EINVAL;
     }
 
-    if (i >= m_regions.size()) {
+    size_t first_page = (unmap_address - old_region->lower()) / Memory::kPageSize;
+    size_t end_page = first_page + ceiling_divide(length, Memory::kPageSize);
+
+    // Large pages can not be split, a huge mapping is only ever unmapped as a whole
+    if (old_region->is_huge() && (first_page != 0 || end_page < old_region->page_count())) {
         return -EINVAL;
     }
 
-    VirtualAddress unmap_lower = Memory::page_round_down(unmap_address);
-    VirtualAddress unmap_upper = Memory::page_round_up(unmap_address.offset(length));
-    size_t unmap_page_count = ceiling_divide((unmap_address.offset(length)) - unmap_address, Memory::kPageSize);
+    // Pages past the hole become a region of their own, keeping their contents and translations
+    if (end_page < old_region->page_count()) {
+        add_region(old_region->split(end_page));
+    }
 
-    VirtualAddress old_lower_address = m_regions[i]->lower();
-    VirtualAddress old_upper_address = m_regions[i]->upper();
-    size_t old_page_count = m_regions[i]->page_count();
-    u8 old_access = m_regions[i]->access();
+    if (first_page == 0) {
+        ASSERT(deallocate_region(*old_region).is_ok());
 
-    ASSERT(deallocate_region(i).is_ok());
+        // TODO: Probably should do this in deallocate_region but causes issues when freeing in loops
+        remove_region(*old_region);
+        delete old_region;
+        return 0;
+    }
 
-    // TODO: Probably should do this in deallocate_region but causes issues when freeing in loops
-    ASSERT(m_regions.remove(i).is_ok());
+    old_region->resize(first_page * Memory::kPageSize);
+    ASSERT(page_directory().address_allocator().free(AddressRange(unmap_address, (end_page - first_page) * Memory::kPageSize)).is_ok());
+    return 0;
+}
 
-    // All pages are being freed so no need to reallocate
-    if (old_page_count == unmap_page_count) {
-        return 0;
+void* Process::sys_mremap(const mremap_args* user_args)
+{
+    mremap_args args;
+    if (copy_from_user(&args, user_args, sizeof(args)).is_error()) {
+        return (void*)-EFAULT;
     }
 
-    size_t length_before_address = unmap_lower - old_lower_address;
-    size_t length_after_address = old_upper_address - unmap_upper;
-    if (length_after_address > 0) {
-        ASSERT(allocate_region_at(unmap_upper, length_after_address, old_access).is_ok());
+    auto& [old_address, old_size, new_size, flags] = args;
+    VirtualAddress old_lower(reinterpret_cast<u32>(old_address));
+
+    if (!Memory::is_page_aligned(old_lower) || old_size == 0 || new_size == 0) {
+        return (void*)-EINVAL;
     }
-    if (length_before_address > 0) {
-        ASSERT(allocate_region_at(old_lower_address, length_before_address, old_access).is_ok());
+
+    // Only whole private anonymous mappings can be remapped, and the heap belongs to brk
+    VirtualRegion* region = find_region(old_lower);
+    if (region == nullptr || region == m_heap || region->is_huge() || region->lower() != old_lower || region->length() != Memory::page_round_up(old_size) || region->vm_object() != nullptr) {
+        return (void*)-EINVAL;
     }
-    return 0;
+
+    size_t old_length = region->length();
+    size_t new_length = Memory::page_round_up(new_size);
+    auto& address_allocator = page_directory().address_allocator();
+
+    if (new_length <= old_length) {
+        if (new_length < old_length) {
+            region->resize(new_length);
+            ASSERT(address_allocator.free(AddressRange(old_lower.offset(new_length), old_length - new_length)).is_ok());
+        }
+        return old_lower.ptr();
+    }
+
+    // Grow in place when nothing is mapped right after the region
+    if (address_allocator.allocate_at(region->upper(), new_length - old_length).is_ok()) {
+        region->resize(new_length);
+        return old_lower.ptr();
+    }
+
+    if (!(flags & MREMAP_MAYMOVE)) {
+        return (void*)-ENOMEM;
+    }
+
+    auto new_range = address_allocator.allocate(new_length);
+    if (new_range.is_error()) {
+        return (void*)-ENOMEM;
+    }
+
+    // Moving only rewrites page table entries, the contents stay in the same physical pages
+    remove_region(*region);
+    ASSERT(address_allocator.free(region->address_range()).is_ok());
+    region->move_to(new_range.value().lower());
+    region->resize(new_length);
+    ASSERT(m_regions.insert(region->lower().get(), region) != nullptr);
+
+    dbgprintf_if(DEBUG_PROCESS, "Process", "Moved virtual region 0x%x to 0x%x - 0x%x for Process '%s'\n", old_lower, region->lower(), region->upper(), name().data());
+
+    return region->lower().ptr();
 }
 
-int Process::sys_open(const char* pathname, int flags, mode_t mode)
+int Process::sys_open(const char* user_pathname, int flags, mode_t mode)
 {
+    char pathname[kMaxPathLength];
+    if (strncpy_from_user(pathname, user_pathname, sizeof(pathname)).is_error()) {
+        return -EFAULT;
+    }
+
     int fd = next_file_descriptor();
 
     auto result = VFS::the().open(pathname, flags, mode, working_directory());
@@ -693,6 +1054,20 @@ ssize_t Process::sys_read(int fd, void* buf, size_t count)
     return fd_result.release_value()->read((u8*)buf, count);
 }
 
+void* Process::sys_sbrk(intptr_t increment)
+{
+    // The first call reserves the heap, so the current break is only known after it
+    if (set_break(m_break).is_error()) {
+        return (void*)-ENOMEM;
+    }
+
+    VirtualAddress old_break = m_break;
+    if (set_break(old_break.get() + increment).is_error()) {
+        return (void*)-ENOMEM;
+    }
+    return old_break.ptr();
+}
+
 pid_t Process::sys_waitpid(pid_t pid, int* wstatus, int options)
 {
     WaitBlocker blocker(*this, pid, options);
@@ -18,6 +18,7 @@
 #include <Universal/BasicString.h>
 #include <Universal/Function.h>
 #include <Universal/LinkedList.h>
+#include <Universal/RedBlackTree.h>
 #include <Universal/Result.h>
 #include <Universal/SharedPtr.h>
 #include <Universal/Types.h>
@@ -54,9 +55,27 @@ public:
     static Expected<Process*> create_user_process(StringView path, pid_t pid, pid_t ppid, ArrayList<StringView>&& argv, DirectoryEntry*, TTYDevice*);
     static Expected<Process*> fork_user_process(Process& parent, TaskRegisters& frame);
 
-    Expected<VirtualRegion*> allocate_region(size_t size, u8 access);
-    Expected<VirtualRegion*> allocate_region_at(VirtualAddress, size_t size, u8 access);
-    Result deallocate_region(size_t index);
+    Expected<VirtualRegion*> allocate_region(size_t size, u8 access, VirtualRegion::AllocationStrategy = VirtualRegion::Eager);
+    Expected<VirtualRegion*> allocate_region_at(VirtualAddress, size_t size, u8 access, VirtualRegion::AllocationStrategy = VirtualRegion::Eager);
+    Expected<VirtualRegion*> allocate_huge_region(size_t size, u8 access);
+    Expected<VirtualRegion*> allocate_vm_object_region_at(VirtualAddress, size_t size, u8 access, SharedPtr<VMObject>, size_t vm_object_page_offset, VirtualRegion::Sharing);
+    Expected<VirtualRegion*> clone_region(VirtualRegion&);
+    Result deallocate_region(VirtualRegion&);
+
+    VirtualRegion* find_region(VirtualAddress);
+    // The region containing the address, or the first one above it
+    VirtualRegion* find_region_from(VirtualAddress);
+
+    // Brackets syscalls and faults that rearrange the regions, which the page merger and
+    // eviction have to leave alone until they are consistent again. A change waits for pages
+    // that are being written out to swap, their regions have to stay put until then.
+    void begin_memory_change();
+    void end_memory_change() { m_memory_changes--; }
+    bool is_changing_memory() const { return m_memory_changes != 0; }
+
+    // Pages of the process that are being written out to swap
+    void begin_page_out() { m_page_outs++; }
+    void end_page_out() { m_page_outs--; }
 
     bool timer_expired() { return --m_ticks_left == 0; }
     void reset_timer_ticks() { m_ticks_left = QUANTUM_IN_MILLISECONDS; }
@@ -70,6 +89,8 @@ public:
 
     bool is_kernel() const { return m_is_kernel; }
     bool is_dead() const { return m_state == Dead; }
+    // Ends a process that faulted in a way that can not be recovered from
+    void crash();
 
     const PageDirectory& page_directory() const { return *m_page_directory; }
     PageDirectory& page_directory() { return *m_page_directory; }
@@ -88,6 +109,7 @@ public:
 
     DirectoryEntry& working_directory();
 
+    void* sys_brk(void* addr);
     int sys_chdir(const char* path);
     int sys_dbgwrite(const char*, size_t);
     int sys_execve(const char* pathname, char* const* argv);
@@ -101,10 +123,14 @@ public:
     uid_t sys_getuid();
     int sys_ioctl(int fd, uint32_t request, uint32_t* argp);
     int sys_isatty(int fd);
+    int sys_madvise(void* addr, size_t length, int advice);
+    int sys_meminfo(meminfo*);
     void* sys_mmap(const mmap_args*);
+    void* sys_mremap(const mremap_args*);
     int sys_munmap(void* addr, size_t length);
     int sys_open(const char*, int, mode_t);
     ssize_t sys_read(int fd, void* buf, size_t count);
+    void* sys_sbrk(intptr_t increment);
     pid_t sys_waitpid(pid_t, int* wstatus, int options);
     ssize_t sys_write(int fd, const void* buf, size_t count);
 
@@ -112,23 +138,35 @@ private:
     static constexpr size_t kKernelStackSize = 16 * KB;
     static constexpr size_t kUserStackSize = 16 * KB;
     static constexpr size_t kMaxFileDescriptors = 64;
+    static constexpr size_t kElfLoadBatchPages = 4;
+    static constexpr size_t kMaxPathLength = 256;
+    static constexpr size_t kMaxStringLength = 4 * KB;
+    static constexpr size_t kUserHeapMaxLength = 256 * MB;
 
     Process(StringView name, pid_t pid, pid_t ppid, bool is_kernel, DirectoryEntry* = nullptr, TTYDevice* = nullptr);
     Process(const Process& parent);
 
+    Expected<AddressRange> allocate_address_range(VirtualAddress, size_t size);
+    VirtualRegion* add_region(UniquePtr<VirtualRegion>&&);
+    void remove_region(VirtualRegion&);
+
     Expected<u32> load_elf();
 
+    Result set_break(VirtualAddress);
+
     Result initialize_kernel_stack(const TaskRegisters&);
     Expected<u32> initialize_user_stack(ArrayList<StringView>&& argv);
 
     bool is_address_accessible(const void*, size_t);
-    bool is_string_accessible(StringView);
+    bool is_string_accessible(const char*);
     int next_file_descriptor();
     Expected<SharedPtr<FileDescriptor>> find_file_descriptor(int fd);
 
     void die();
 
     u8 m_ticks_left { 0 };
+    u8 m_memory_changes { 0 };
+    u8 m_page_outs { 0 };
 
     String m_name;
     pid_t m_pid { 0 };
@@ -142,14 +180,24 @@ private:
     SharedPtr<PageDirectory> m_page_directory;
     Blocker* m_blocker { nullptr };
 
-    // TODO: Make sure this memory is being freed!
-    ArrayList<VirtualRegion*> m_regions;
+    // User regions keyed by their lower address. Syscall validation usually checks
+    // the same buffer a few times in a row, so the last lookup is cached.
+    using RegionTree = RedBlackTree<u32, VirtualRegion*>;
+    RegionTree m_regions;
+    VirtualRegion* m_last_found_region { nullptr };
     Array<SharedPtr<FileDescriptor>, kMaxFileDescriptors> m_fds;
 
     UniquePtr<VirtualRegion> m_kernel_stack { nullptr };
-    UniquePtr<VirtualRegion> m_user_stack { nullptr };
+    // Owned by m_regions like every other user region
+    VirtualRegion* m_user_stack { nullptr };
     u32* m_previous_stack_pointer { nullptr };
 
+    // The heap grows in place inside an address range reserved on the first brk, so nothing
+    // else can be mapped where it needs to grow. Its region only exists while it is non-empty.
+    AddressRange m_heap_reservation;
+    VirtualRegion* m_heap { nullptr };
+    VirtualAddress m_break;
+
     State m_state;
 
     Process* m_next { nullptr };
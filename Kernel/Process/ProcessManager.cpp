@@ -9,6 +9,7 @@
 #include <Kernel/CPU/IDT.h>
 #include <Kernel/CPU/PIC.h>
 #include <Kernel/Devices/PIT.h>
+#include <Kernel/Memory/MemoryManager.h>
 #include <Kernel/Memory/Paging.h>
 #include <Kernel/Process/ProcessManager.h>
 #include <Kernel/kmalloc.h>
@@ -21,8 +22,10 @@ bool ProcessManager::s_started = false;
 static void kernel_idle_process()
 {
     dbgprintf("ProcessManager", "Starting the idle process!\n");
-    while (true)
-        ;
+    while (true) {
+        MM.refill_zeroed_page_pools();
+        asm volatile("hlt");
+    }
 }
 
 ProcessManager& ProcessManager::the()
@@ -94,6 +97,20 @@ Process* ProcessManager::from_pid(pid_t pid) const
     return nullptr;
 }
 
+Process* ProcessManager::find_user_process_from(pid_t pid) const
+{
+    Process* found = nullptr;
+    for (Process* p = m_processes->head(); p != nullptr; p = p->next()) {
+        if (p->is_kernel() || p->is_dead() || p->pid() < pid) {
+            continue;
+        }
+        if (found == nullptr || p->pid() < found->pid()) {
+            found = p;
+        }
+    }
+    return found;
+}
+
 void ProcessManager::for_each_child(Process& parent, Function<bool(Process&)> callback) const
 {
     for (Process* p = m_processes->head(); p != nullptr; p = p->next()) {
@@ -37,6 +37,8 @@ public:
     pid_t get_next_pid() { return m_current_pid++; }
 
     Process* from_pid(pid_t) const;
+    // The live user process with the lowest pid not below the given one
+    Process* find_user_process_from(pid_t) const;
     void for_each_child(Process&, Function<bool(Process&)>) const;
 
     void schedule();
@@ -45,6 +47,7 @@ public:
 
     void enter_critical();
     void exit_critical();
+    bool is_in_critical() const { return m_critical_count != 0; }
 
     TSS* tss() { return &m_tss; }
 
@@ -21,6 +21,8 @@ int handle(TaskRegisters& regs, SyscallOpcode call, int arg1, int arg2, int arg3
     dbgprintf_if(TRACE_SYSCALLS, "Syscall", "%s called %s()\n", p.name().data(), syscall_opcode_to_string(call));
 
     switch (call) {
+        case SYS_brk:
+            return (int)p.sys_brk((void*)arg1);
         case SYS_chdir:
             return p.sys_chdir((const char*)arg1);
         case SYS_dbgwrite:
@@ -49,14 +51,22 @@ int handle(TaskRegisters& regs, SyscallOpcode call, int arg1, int arg2, int arg3
             return p.sys_ioctl(arg1, arg2, (uint32_t*)arg3);
         case SYS_isatty:
             return p.sys_isatty(arg1);
+        case SYS_madvise:
+            return p.sys_madvise((void*)arg1, arg2, arg3);
+        case SYS_meminfo:
+            return p.sys_meminfo((meminfo*)arg1);
         case SYS_mmap:
             return (int)p.sys_mmap((const mmap_args*)arg1);
+        case SYS_mremap:
+            return (int)p.sys_mremap((const mremap_args*)arg1);
         case SYS_munmap:
             return p.sys_munmap((void*)arg1, arg2);
         case SYS_open:
             return p.sys_open((const char*)arg1, arg2, (mode_t)arg3);
         case SYS_read:
             return p.sys_read(arg1, (void*)arg2, arg3);
+        case SYS_sbrk:
+            return (int)p.sys_sbrk((intptr_t)arg1);
         case SYS_waitpid:
             return p.sys_waitpid((pid_t)arg1, (int*)arg2, arg3);
         case SYS_write:
@@ -69,10 +79,40 @@ int handle(TaskRegisters& regs, SyscallOpcode call, int arg1, int arg2, int arg3
     return 0;
 }
 
+static bool changes_memory(SyscallOpcode call)
+{
+    switch (call) {
+        case SYS_brk:
+        case SYS_execve:
+        case SYS_exit:
+        case SYS_fork:
+        case SYS_madvise:
+        case SYS_mmap:
+        case SYS_mremap:
+        case SYS_munmap:
+        case SYS_sbrk:
+            return true;
+        default:
+            return false;
+    }
+}
+
 void syscall_handler(TaskRegisters& regs)
 {
-    regs.general_purpose.eax = handle(regs, static_cast<SyscallOpcode>(regs.general_purpose.eax),
-        regs.general_purpose.ebx, regs.general_purpose.ecx, regs.general_purpose.edx);
+    auto call = static_cast<SyscallOpcode>(regs.general_purpose.eax);
+
+    // Exiting and exec never come back here, but the process is dead by then and never looked at again
+    auto& process = PM.current_process();
+    bool is_memory_change = changes_memory(call);
+    if (is_memory_change) {
+        process.begin_memory_change();
+    }
+
+    regs.general_purpose.eax = handle(regs, call, regs.general_purpose.ebx, regs.general_purpose.ecx, regs.general_purpose.edx);
+
+    if (is_memory_change) {
+        process.end_memory_change();
+    }
 }
 
 }
@@ -1,20 +1,384 @@
+#include <Kernel/Memory/MemoryManager.h>
+#include <Kernel/Memory/PagingTypes.h>
+#include <Kernel/Memory/VirtualRegion.h>
 #include <Kernel/kmalloc.h>
 #include <Universal/Assert.h>
 #include <Universal/Logger.h>
+#include <Universal/Number.h>
 #include <Universal/Stdlib.h>
 
 #define DEBUG_KMALLOC 0
-#define KMALLOC_FOREVER_SIZE (KB * 512)
 
-__attribute__((section(".heap"))) static u8 kmalloc_initial_heap[KMALLOC_INITIAL_HEAP_SIZE];
+static constexpr u32 kSlabMagic = 0x736c6162;
+static constexpr u32 kLargeMagic = 0x6c617267;
+
+static_assert(sizeof(KmallocPage) <= KMALLOC_PAGE_HEADER_SIZE);
+
+__attribute__((section(".heap"), aligned(Memory::kPageSize))) static u8 kmalloc_initial_heap[KMALLOC_INITIAL_HEAP_SIZE];
 
 static KmallocTracker* s_kmalloc_tracker;
 alignas(KmallocTracker) static u8 s_kmalloc_tracker_heap[sizeof(KmallocTracker)];
 
-void KmallocTracker::add_heap(u8* heap, size_t heap_size)
+void SlabCache::init(u32 object_size)
+{
+    m_object_size = object_size;
+    m_objects_per_slab = (Memory::kPageSize - KMALLOC_PAGE_HEADER_SIZE) / object_size;
+}
+
+void* SlabCache::allocate()
 {
-    // TODO: This should append to a list, not override the original heap
-    m_heap = Heap<KMALLOC_HEAP_CHUNK_SIZE>(heap, heap_size);
+    if (m_partial_slabs == nullptr) {
+        return nullptr;
+    }
+
+    auto& slab = *m_partial_slabs;
+    auto* object = slab.free_objects;
+    slab.free_objects = object->next;
+    slab.used_objects++;
+    m_used_objects++;
+
+    if (slab.used_objects == m_objects_per_slab) {
+        unlink(slab);
+    }
+
+    return object;
+}
+
+void SlabCache::add_slab(KmallocPage& slab)
+{
+    slab.magic = kSlabMagic;
+    slab.object_size = m_object_size;
+    slab.page_count = 1;
+    slab.used_objects = 0;
+    slab.free_objects = nullptr;
+
+    u8* objects = reinterpret_cast<u8*>(&slab) + KMALLOC_PAGE_HEADER_SIZE;
+    for (u32 i = m_objects_per_slab; i > 0; i--) {
+        auto* object = reinterpret_cast<KmallocFreeObject*>(objects + (i - 1) * m_object_size);
+        object->next = slab.free_objects;
+        slab.free_objects = object;
+    }
+
+    link(slab);
+    m_slab_count++;
+}
+
+bool SlabCache::deallocate(KmallocPage& slab, void* ptr)
+{
+    bool was_full = slab.used_objects == m_objects_per_slab;
+
+    auto* object = static_cast<KmallocFreeObject*>(ptr);
+    object->next = slab.free_objects;
+    slab.free_objects = object;
+    slab.used_objects--;
+    m_used_objects--;
+
+    if (was_full) {
+        link(slab);
+    }
+
+    // Keep a single empty slab around so churn at a slab boundary does not bounce pages
+    if (slab.used_objects == 0 && (m_partial_slabs != &slab || slab.next != nullptr)) {
+        unlink(slab);
+        m_slab_count--;
+        return true;
+    }
+
+    return false;
+}
+
+void SlabCache::link(KmallocPage& slab)
+{
+    slab.previous = nullptr;
+    slab.next = m_partial_slabs;
+    if (m_partial_slabs != nullptr) {
+        m_partial_slabs->previous = &slab;
+    }
+    m_partial_slabs = &slab;
+}
+
+void SlabCache::unlink(KmallocPage& slab)
+{
+    if (slab.previous != nullptr) {
+        slab.previous->next = slab.next;
+    } else {
+        m_partial_slabs = slab.next;
+    }
+
+    if (slab.next != nullptr) {
+        slab.next->previous = slab.previous;
+    }
+
+    slab.next = nullptr;
+    slab.previous = nullptr;
+}
+
+void KmallocArena::init(u8* base, size_t page_count, VirtualRegion* region)
+{
+    m_base = base;
+    m_page_count = page_count;
+    m_free_pages = 0;
+    m_peak_used_pages = 0;
+    m_free_runs = nullptr;
+    m_region = region;
+
+    free_pages(base, page_count);
+}
+
+KmallocPage* KmallocArena::allocate_pages(size_t page_count)
+{
+    for (KmallocFreeRun** link = &m_free_runs; *link != nullptr; link = &(*link)->next) {
+        auto* run = *link;
+        if (run->page_count < page_count) {
+            continue;
+        }
+
+        m_free_pages -= page_count;
+        if (m_page_count - m_free_pages > m_peak_used_pages) {
+            m_peak_used_pages = m_page_count - m_free_pages;
+        }
+
+        run->page_count -= page_count;
+        if (run->page_count == 0) {
+            *link = run->next;
+            return reinterpret_cast<KmallocPage*>(run);
+        }
+
+        // Carve from the end of the run so the run itself stays in place
+        return reinterpret_cast<KmallocPage*>(reinterpret_cast<u8*>(run) + run->page_count * Memory::kPageSize);
+    }
+
+    return nullptr;
+}
+
+void KmallocArena::free_pages(u8* address, size_t page_count)
+{
+    // Runs are kept sorted by address so that neighbouring runs can be merged back together
+    KmallocFreeRun* previous = nullptr;
+    KmallocFreeRun* next = m_free_runs;
+    while (next != nullptr && reinterpret_cast<u8*>(next) < address) {
+        previous = next;
+        next = next->next;
+    }
+
+    auto* run = reinterpret_cast<KmallocFreeRun*>(address);
+    run->page_count = page_count;
+    run->next = next;
+    m_free_pages += page_count;
+
+    if (next != nullptr && address + page_count * Memory::kPageSize == reinterpret_cast<u8*>(next)) {
+        run->page_count += next->page_count;
+        run->next = next->next;
+    }
+
+    if (previous == nullptr) {
+        m_free_runs = run;
+    } else if (reinterpret_cast<u8*>(previous) + previous->page_count * Memory::kPageSize == address) {
+        previous->page_count += run->page_count;
+        previous->next = run->next;
+    } else {
+        previous->next = run;
+    }
+}
+
+KmallocTracker::KmallocTracker(u8* initial_heap, size_t initial_heap_size)
+{
+    u32 object_size = KMALLOC_MIN_SLAB_OBJECT_SIZE;
+    for (size_t i = 0; i < KMALLOC_SLAB_CACHE_COUNT; i++) {
+        m_slab_caches[i].init(object_size);
+        object_size *= 2;
+    }
+
+    m_arenas[0].init(initial_heap, initial_heap_size / Memory::kPageSize, nullptr);
+    m_arena_count = 1;
+    m_peak_arena_count = 1;
+    m_free_pages = m_arenas[0].free_pages();
+}
+
+void* KmallocTracker::allocate(size_t size)
+{
+    auto* slab_cache = find_slab_cache(size);
+    if (slab_cache != nullptr) {
+        void* address = slab_cache->allocate();
+        if (address != nullptr) {
+            return address;
+        }
+
+        auto* slab = allocate_pages(1);
+        if (slab == nullptr) {
+            return nullptr;
+        }
+
+        slab_cache->add_slab(*slab);
+        return slab_cache->allocate();
+    }
+
+    size_t page_count = ceiling_divide(size + KMALLOC_PAGE_HEADER_SIZE, Memory::kPageSize);
+    auto* pages = allocate_pages(page_count);
+    if (pages == nullptr) {
+        return nullptr;
+    }
+
+    pages->magic = kLargeMagic;
+    pages->object_size = 0;
+    pages->page_count = page_count;
+    m_large_allocations++;
+    m_large_pages += page_count;
+
+    return reinterpret_cast<u8*>(pages) + KMALLOC_PAGE_HEADER_SIZE;
+}
+
+void KmallocTracker::deallocate(void* ptr)
+{
+    if (ptr == nullptr) {
+        return;
+    }
+
+    auto* page = reinterpret_cast<KmallocPage*>(Memory::page_round_down(reinterpret_cast<u32>(ptr)));
+    ASSERT(page->magic == kSlabMagic || page->magic == kLargeMagic);
+
+    if (page->magic == kLargeMagic) {
+        m_large_allocations--;
+        m_large_pages -= page->page_count;
+        free_pages(*page);
+        return;
+    }
+
+    auto* slab_cache = find_slab_cache(page->object_size);
+    ASSERT(slab_cache != nullptr);
+    if (slab_cache->deallocate(*page, ptr)) {
+        free_pages(*page);
+    }
+}
+
+size_t KmallocTracker::release_idle_arenas()
+{
+    if (m_is_resizing) {
+        return 0;
+    }
+
+    m_is_resizing = true;
+
+    // The initial heap is static and never released
+    size_t released_pages = 0;
+    for (size_t i = m_arena_count - 1; i > 0; i--) {
+        auto& arena = m_arenas[i];
+        if (!arena.is_idle()) {
+            continue;
+        }
+
+        auto* region = arena.region();
+        m_free_pages -= arena.page_count();
+        released_pages += arena.page_count();
+        m_arenas[i] = m_arenas[--m_arena_count];
+
+        MM.free_kernel_region(*region);
+        delete region;
+    }
+
+    m_is_resizing = false;
+
+    dbgprintf_if(DEBUG_KMALLOC, "kmalloc", "Released %u pages of idle arenas\n", released_pages);
+    return released_pages;
+}
+
+SlabCache* KmallocTracker::find_slab_cache(size_t size)
+{
+    if (size > KMALLOC_MAX_SLAB_OBJECT_SIZE) {
+        return nullptr;
+    }
+
+    size_t index = 0;
+    while (m_slab_caches[index].object_size() < size) {
+        index++;
+    }
+    return &m_slab_caches[index];
+}
+
+KmallocPage* KmallocTracker::allocate_pages(size_t page_count)
+{
+    // Grow before running dry so that the allocations made while growing are served from the reserve
+    if (m_free_pages < page_count + KMALLOC_ARENA_RESERVE_PAGES) {
+        grow(page_count);
+    }
+
+    auto* pages = find_free_pages(page_count);
+    if (pages == nullptr && grow(page_count)) {
+        pages = find_free_pages(page_count);
+    }
+
+    return pages;
+}
+
+KmallocPage* KmallocTracker::find_free_pages(size_t page_count)
+{
+    for (size_t i = 0; i < m_arena_count; i++) {
+        auto* pages = m_arenas[i].allocate_pages(page_count);
+        if (pages != nullptr) {
+            m_free_pages -= page_count;
+            return pages;
+        }
+    }
+    return nullptr;
+}
+
+void KmallocTracker::free_pages(KmallocPage& pages)
+{
+    auto* address = reinterpret_cast<u8*>(&pages);
+    size_t page_count = pages.page_count;
+    pages.magic = 0;
+
+    for (size_t i = 0; i < m_arena_count; i++) {
+        if (m_arenas[i].contains(address)) {
+            m_arenas[i].free_pages(address, page_count);
+            m_free_pages += page_count;
+            return;
+        }
+    }
+
+    panic("kmalloc: Freeing pages at 0x%x outside of every arena\n", address);
+}
+
+bool KmallocTracker::grow(size_t page_count)
+{
+    if (!m_can_grow || m_is_resizing || m_arena_count >= KMALLOC_MAX_ARENA_COUNT) {
+        return false;
+    }
+
+    m_is_resizing = true;
+
+    size_t arena_size = KMALLOC_ARENA_SIZE;
+    if (page_count * Memory::kPageSize > arena_size) {
+        arena_size = page_count * Memory::kPageSize;
+    }
+
+    auto* region = MM.allocate_kernel_region(arena_size).leak_ptr();
+
+    auto& arena = m_arenas[m_arena_count++];
+    arena.init(region->lower().ptr(), region->page_count(), region);
+    m_free_pages += arena.page_count();
+    if (m_arena_count > m_peak_arena_count) {
+        m_peak_arena_count = m_arena_count;
+    }
+
+    m_is_resizing = false;
+
+    dbgprintf_if(DEBUG_KMALLOC, "kmalloc", "Added %u KiB arena @ 0x%x\n", arena_size / KB, region->lower());
+    return true;
+}
+
+void KmallocTracker::dump_statistics() const
+{
+    dbgprintf("kmalloc", "%u arenas (peak %u), %u pages free\n", m_arena_count, m_peak_arena_count, m_free_pages);
+    for (size_t i = 0; i < m_arena_count; i++) {
+        auto& arena = m_arenas[i];
+        dbgprintf("kmalloc", "  Arena %u @ 0x%x: %u of %u pages used, peak %u\n", i, arena.base(), arena.page_count() - arena.free_pages(), arena.page_count(), arena.peak_used_pages());
+    }
+    for (size_t i = 0; i < KMALLOC_SLAB_CACHE_COUNT; i++) {
+        auto& slab_cache = m_slab_caches[i];
+        dbgprintf("kmalloc", "  %u byte objects: %u of %u used in %u slabs\n", slab_cache.object_size(), slab_cache.used_objects(), slab_cache.slab_count() * slab_cache.objects_per_slab(), slab_cache.slab_count());
+    }
+    dbgprintf("kmalloc", "  Large allocations: %u using %u pages\n", m_large_allocations, m_large_pages);
 }
 
 void* kmalloc(size_t size)
@@ -25,38 +389,43 @@ void* kmalloc(size_t size)
         return 0;
     }
 
-    void* address = s_kmalloc_tracker->heap().allocate(size);
+    void* address = s_kmalloc_tracker->allocate(size);
     dbgprintf_if(DEBUG_KMALLOC, "kmalloc", "%d byte allocation @ 0x%x\n", size, address);
     return address;
 }
 
 void* kcalloc(size_t size)
 {
-    ASSERT(s_kmalloc_tracker != nullptr);
-    if (size == 0) {
-        dbgprintf_if(DEBUG_KMALLOC, "kmalloc", "Ignoring 0 byte allocation\n");
-        return 0;
+    void* address = kmalloc(size);
+    if (address != nullptr) {
+        memset(address, 0, size);
     }
-
-    void* address = s_kmalloc_tracker->heap().allocate(size);
-    dbgprintf_if(DEBUG_KMALLOC, "kmalloc", "%d byte allocation @ 0x%x\n", size, address);
-    memset(address, 0, size);
     return address;
 }
 
 void kfree(void* ptr)
 {
     dbgprintf_if(DEBUG_KMALLOC, "kmalloc", "free @ 0x%x\n", ptr);
-    s_kmalloc_tracker->heap().deallocate(ptr);
+    s_kmalloc_tracker->deallocate(ptr);
 }
 
 void kmalloc_init()
 {
     s_kmalloc_tracker = new (s_kmalloc_tracker_heap) KmallocTracker(kmalloc_initial_heap, KMALLOC_INITIAL_HEAP_SIZE);
-    dbgprintf("kmalloc", "Initialized kmalloc: 0x%x, total_chunks=%d\n", s_kmalloc_tracker, s_kmalloc_tracker->heap().total_chunks());
+    dbgprintf("kmalloc", "Initialized kmalloc: 0x%x, %u KiB initial heap\n", s_kmalloc_tracker, KMALLOC_INITIAL_HEAP_SIZE / KB);
+}
+
+void kmalloc_enable_growth()
+{
+    s_kmalloc_tracker->enable_growth();
+}
+
+size_t kmalloc_release_idle_arenas()
+{
+    return s_kmalloc_tracker->release_idle_arenas();
 }
 
 void kmalloc_dump_statistics()
 {
-    dbgprintf("kmalloc", "%u chunks allocated, %u chunks free, %u total chunks\n", s_kmalloc_tracker->heap().allocated_chunks(), s_kmalloc_tracker->heap().free_chunks(), s_kmalloc_tracker->heap().total_chunks());
+    s_kmalloc_tracker->dump_statistics();
 }
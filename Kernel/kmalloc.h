@@ -7,26 +7,125 @@
 #pragma once
 
 #include <Kernel/Memory/Address.h>
-#include <Universal/Heap.h>
+#include <Kernel/Memory/PagingTypes.h>
 #include <Universal/Types.h>
 
 #define KMALLOC_INITIAL_HEAP_SIZE (MB * 1)
-#define KMALLOC_HEAP_CHUNK_SIZE 32
+#define KMALLOC_ARENA_SIZE (KB * 128)
+#define KMALLOC_ARENA_RESERVE_PAGES 8
+#define KMALLOC_MAX_ARENA_COUNT 256
+#define KMALLOC_PAGE_HEADER_SIZE 32
+#define KMALLOC_MIN_SLAB_OBJECT_SIZE 16
+#define KMALLOC_MAX_SLAB_OBJECT_SIZE 1024
+#define KMALLOC_SLAB_CACHE_COUNT 7
+
+class VirtualRegion;
+
+struct KmallocFreeObject {
+    KmallocFreeObject* next;
+};
+
+struct KmallocFreeRun {
+    size_t page_count;
+    KmallocFreeRun* next;
+};
+
+// Every page handed out by kmalloc starts with this header. It either describes a slab of
+// equally sized objects or a large allocation spanning one or more pages.
+struct KmallocPage {
+    u32 magic;
+    u32 object_size;
+    u32 page_count;
+    u32 used_objects;
+    KmallocFreeObject* free_objects;
+    KmallocPage* next;
+    KmallocPage* previous;
+};
+
+class SlabCache {
+public:
+    void init(u32 object_size);
+
+    void* allocate();
+    void add_slab(KmallocPage&);
+    bool deallocate(KmallocPage&, void*);
+
+    u32 object_size() const { return m_object_size; }
+    u32 objects_per_slab() const { return m_objects_per_slab; }
+    size_t slab_count() const { return m_slab_count; }
+    size_t used_objects() const { return m_used_objects; }
+
+private:
+    void link(KmallocPage&);
+    void unlink(KmallocPage&);
+
+    u32 m_object_size { 0 };
+    u32 m_objects_per_slab { 0 };
+    KmallocPage* m_partial_slabs { nullptr };
+    size_t m_slab_count { 0 };
+    size_t m_used_objects { 0 };
+};
+
+// A contiguous range of pages that slabs and large allocations are carved from. The first
+// arena is the static initial heap, the rest are kernel regions added as the heap grows.
+class KmallocArena {
+public:
+    void init(u8* base, size_t page_count, VirtualRegion*);
+
+    KmallocPage* allocate_pages(size_t page_count);
+    void free_pages(u8* address, size_t page_count);
+
+    bool contains(const u8* address) const { return address >= m_base && address < m_base + m_page_count * Memory::kPageSize; }
+    bool is_idle() const { return m_free_pages == m_page_count; }
+
+    u8* base() const { return m_base; }
+    size_t page_count() const { return m_page_count; }
+    size_t free_pages() const { return m_free_pages; }
+    size_t peak_used_pages() const { return m_peak_used_pages; }
+    VirtualRegion* region() const { return m_region; }
+
+private:
+    u8* m_base { nullptr };
+    size_t m_page_count { 0 };
+    size_t m_free_pages { 0 };
+    size_t m_peak_used_pages { 0 };
+    KmallocFreeRun* m_free_runs { nullptr };
+    VirtualRegion* m_region { nullptr };
+};
 
 class KmallocTracker {
 public:
-    KmallocTracker(u8* initial_heap, size_t initial_heap_size)
-        : m_heap(initial_heap, initial_heap_size)
-    {
-    }
+    KmallocTracker(u8* initial_heap, size_t initial_heap_size);
 
-    const Heap<KMALLOC_HEAP_CHUNK_SIZE>& heap() const { return m_heap; }
-    Heap<KMALLOC_HEAP_CHUNK_SIZE>& heap() { return m_heap; }
+    void* allocate(size_t);
+    void deallocate(void*);
+
+    void enable_growth() { m_can_grow = true; }
+    size_t release_idle_arenas();
+
+    void dump_statistics() const;
 
 private:
-    void add_heap(u8* heap, size_t heap_size);
+    SlabCache* find_slab_cache(size_t size);
+
+    KmallocPage* allocate_pages(size_t page_count);
+    KmallocPage* find_free_pages(size_t page_count);
+    void free_pages(KmallocPage&);
+
+    bool grow(size_t page_count);
+
+    SlabCache m_slab_caches[KMALLOC_SLAB_CACHE_COUNT];
+
+    KmallocArena m_arenas[KMALLOC_MAX_ARENA_COUNT];
+    size_t m_arena_count { 0 };
+    size_t m_free_pages { 0 };
+    size_t m_peak_arena_count { 0 };
+
+    bool m_can_grow { false };
+    bool m_is_resizing { false };
 
-    Heap<KMALLOC_HEAP_CHUNK_SIZE> m_heap;
+    size_t m_large_allocations { 0 };
+    size_t m_large_pages { 0 };
 };
 
 void* kmalloc(size_t);
@@ -35,4 +134,6 @@ void* kcalloc(size_t);
 void kfree(void*);
 
 void kmalloc_init();
+void kmalloc_enable_growth();
+size_t kmalloc_release_idle_arenas();
 void kmalloc_dump_statistics();
@@ -5,40 +5,52 @@
  */
 
 #include <MallocManager.h>
+#include <Universal/Malloc.h>
+#include <Universal/Number.h>
 #include <stdio.h>
-#include <sys/mman.h>
+#include <unistd.h>
 
 bool MallocManager::add_heap(size_t heap_size)
 {
-    void* heap = mmap(nullptr, heap_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-    if (heap == nullptr) {
+    // Every heap is carved off the program break, so they all sit back to back in one region
+    void* heap = sbrk(heap_size);
+    if (heap == (void*)-1) {
         return false;
     }
 
-    m_heaps[m_heap_count++] = Heap<kHeapChunkSize>(static_cast<u8*>(heap), heap_size);
+    auto* heap_block = new (heap) HeapBlock { Heap<kHeapChunkSize>(static_cast<u8*>(heap) + kHeapBlockSize, heap_size - kHeapBlockSize) };
+    if (m_last_heap == nullptr) {
+        m_first_heap = heap_block;
+    } else {
+        m_last_heap->next = heap_block;
+    }
+    m_last_heap = heap_block;
     return true;
 }
 
 void* MallocManager::allocate(size_t size)
 {
-    for (size_t i = 0; i < m_heap_count; i++) {
-        void* ptr = m_heaps[i].allocate(size);
+    for (auto* heap_block = m_first_heap; heap_block != nullptr; heap_block = heap_block->next) {
+        void* ptr = heap_block->heap.allocate(size);
         if (ptr != nullptr) {
             return ptr;
         }
     }
 
-    if (!add_heap(kHeapSize)) {
+    // Leave room for the heap block, the allocation header, the heap's bitmap and chunk rounding
+    size_t needed_size = size + sizeof(AllocationHeader);
+    size_t heap_size = ceiling_divide(kHeapBlockSize + needed_size + needed_size / (8 * kHeapChunkSize) + 4 * kHeapChunkSize, kHeapSize) * kHeapSize;
+    if (!add_heap(heap_size)) {
         return nullptr;
     }
 
-    return m_heaps[m_heap_count - 1].allocate(size);
+    return m_last_heap->heap.allocate(size);
 }
 
 void MallocManager::deallocate(void* ptr)
 {
-    for (size_t i = 0; i < m_heap_count; i++) {
-        if (m_heaps[i].deallocate(ptr)) {
+    for (auto* heap_block = m_first_heap; heap_block != nullptr; heap_block = heap_block->next) {
+        if (heap_block->heap.deallocate(ptr)) {
             break;
         }
     }
@@ -4,7 +4,6 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
-#include <Universal/Array.h>
 #include <Universal/Heap.h>
 #include <Universal/Result.h>
 #include <Universal/Types.h>
@@ -17,12 +16,18 @@ public:
     void deallocate(void* ptr);
 
 private:
-    static constexpr size_t kHeapCount = 10;
     static constexpr size_t kHeapChunkSize = 32;
     static constexpr size_t kHeapSize = 4096;
 
+    // Lives at the start of the memory it manages, so there can be as many heaps as sbrk allows
+    struct HeapBlock {
+        Heap<kHeapChunkSize> heap;
+        HeapBlock* next { nullptr };
+    };
+    static constexpr size_t kHeapBlockSize = (sizeof(HeapBlock) + kHeapChunkSize - 1) / kHeapChunkSize * kHeapChunkSize;
+
     bool add_heap(size_t heap_size);
 
-    Array<Heap<kHeapChunkSize>, kHeapCount> m_heaps;
-    size_t m_heap_count { 0 };
+    HeapBlock* m_first_heap { nullptr };
+    HeapBlock* m_last_heap { nullptr };
 };
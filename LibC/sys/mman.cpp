@@ -18,8 +18,29 @@ void* mmap(void* addr, size_t length, int prot, int flags, int fd, off_t offset)
     RETURN_ERRNO(ret, (void*)ret, (void*)-1);
 }
 
+void* mremap(void* old_address, size_t old_size, size_t new_size, int flags)
+{
+    mremap_args args = {
+        old_address, old_size, new_size, flags
+    };
+    int ret = syscall(SYS_mremap, (int)&args);
+    RETURN_ERRNO(ret, (void*)ret, (void*)-1);
+}
+
 int munmap(void* addr, size_t length)
 {
     int ret = syscall(SYS_munmap, (int)addr, length);
     RETURN_ERRNO(ret, ret, -1);
 }
+
+int madvise(void* addr, size_t length, int advice)
+{
+    int ret = syscall(SYS_madvise, (int)addr, length, advice);
+    RETURN_ERRNO(ret, ret, -1);
+}
+
+int meminfo(struct meminfo* info)
+{
+    int ret = syscall(SYS_meminfo, (int)info);
+    RETURN_ERRNO(ret, ret, -1);
+}
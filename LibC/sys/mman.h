@@ -8,22 +8,40 @@
 #define _MMAN_H_
 
 #include <Universal/Types.h>
+#include <sys/syscall_defines.h>
 
 #define MAP_SHARED 0x01
 #define MAP_PRIVATE 0x02
 #define MAP_FIXED 0x04
 #define MAP_ANONYMOUS 0x08
 #define MAP_ANON MAP_ANONYMOUS
+#define MAP_POPULATE 0x10
+#define MAP_HUGETLB 0x20
 
 #define PROT_NONE 0x00
 #define PROT_READ 0x01
 #define PROT_WRITE 0x02
 #define PROT_EXEC 0x04
 
+#define MREMAP_MAYMOVE 0x01
+
+#define MADV_NORMAL 0
+#define MADV_SEQUENTIAL 2
+#define MADV_WILLNEED 3
+#define MADV_DONTNEED 4
+
 #define MAP_FAILED ((void*)-1)
 
 void* mmap(void* addr, size_t length, int prot, int flags, int fd, off_t offset);
 
 int munmap(void* addr, size_t length);
 
+// Grows or shrinks a private anonymous mapping, moving it only when MREMAP_MAYMOVE allows
+void* mremap(void* old_address, size_t old_size, size_t new_size, int flags);
+
+int madvise(void* addr, size_t length, int advice);
+
+// Physical memory usage of the whole system
+int meminfo(struct meminfo*);
+
 #endif
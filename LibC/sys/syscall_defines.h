@@ -9,6 +9,7 @@
 #include <sys/types.h>
 
 #define SYSCALL_OPCODE_LIST       \
+    SYSCALL_OPCODE(brk)           \
     SYSCALL_OPCODE(chdir)         \
     SYSCALL_OPCODE(dbgwrite)      \
     SYSCALL_OPCODE(execve)        \
@@ -22,10 +23,14 @@
     SYSCALL_OPCODE(getuid)        \
     SYSCALL_OPCODE(ioctl)         \
     SYSCALL_OPCODE(isatty)        \
+    SYSCALL_OPCODE(madvise)       \
+    SYSCALL_OPCODE(meminfo)       \
     SYSCALL_OPCODE(mmap)          \
+    SYSCALL_OPCODE(mremap)        \
     SYSCALL_OPCODE(munmap)        \
     SYSCALL_OPCODE(open)          \
     SYSCALL_OPCODE(read)          \
+    SYSCALL_OPCODE(sbrk)          \
     SYSCALL_OPCODE(waitpid)       \
     SYSCALL_OPCODE(write)
 
@@ -50,6 +55,19 @@ inline constexpr const char* syscall_opcode_to_string(SyscallOpcode call)
 }
 #undef SYSCALL_OPCODE
 
+struct meminfo {
+    size_t kernel_pages_free;
+    size_t kernel_pages_total;
+    size_t user_pages_free;
+    size_t user_pages_total;
+    size_t swap_pages_free;
+    size_t swap_pages_total;
+    size_t compressed_swap_pages;
+    size_t compressed_swap_bytes;
+    size_t merged_pages_shared;
+    size_t merged_pages_saved;
+};
+
 struct mmap_args {
     void* addr;
     size_t length;
@@ -58,3 +76,10 @@ struct mmap_args {
     int fd;
     off_t offset;
 };
+
+struct mremap_args {
+    void* old_address;
+    size_t old_size;
+    size_t new_size;
+    int flags;
+};
@@ -91,4 +91,21 @@ int chdir(const char* path)
     RETURN_ERRNO(ret, ret, -1);
 }
 
+int brk(void* addr)
+{
+    // The kernel answers with the break it ended up with, which is the old one on failure
+    void* ret = (void*)syscall(SYS_brk, (int)addr);
+    if (ret != addr) {
+        errno = ENOMEM;
+        return -1;
+    }
+    return 0;
+}
+
+void* sbrk(intptr_t increment)
+{
+    int ret = syscall(SYS_sbrk, increment);
+    RETURN_ERRNO(ret, (void*)ret, (void*)-1);
+}
+
 __END_DECLS
@@ -35,6 +35,9 @@ char* getcwd(char* buf, size_t size);
 
 int chdir(const char* path);
 
+int brk(void* addr);
+void* sbrk(intptr_t increment);
+
 __END_DECLS
 
 #endif
@@ -30,7 +30,7 @@ echo "using grub-install at ${GRUB_BIN}"
 HEADS=16
 SECTORS=63
 BYTES_PER_SECTOR=512
-DISK_SIZE=32 # in MB
+DISK_SIZE=96 # in MB, the last 64 MB are swap
 
 BYTES=$(($HEADS*$SECTORS*$BYTES_PER_SECTOR))
 CYLINDERS=$((($DISK_SIZE*1000*1024)/$BYTES))
@@ -65,7 +65,7 @@ cleanup() {
 trap cleanup EXIT
 
 echo "creating partition table..."
-parted -s "${LOOPBACK}" mklabel msdos mkpart primary ext2 32k 100% -a minimal set 1 boot on || die "couldn't partition disk"
+parted -s "${LOOPBACK}" mklabel msdos mkpart primary ext2 32k 32MiB mkpart primary linux-swap 32MiB 100% -a minimal set 1 boot on || die "couldn't partition disk"
 echo "done"
 
 echo "removing old filesystem... "
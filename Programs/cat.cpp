@@ -7,6 +7,8 @@
 #include <Universal/Types.h>
 #include <fcntl.h>
 #include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include <errno.h>
@@ -20,14 +22,25 @@ int main(int argc, char** argv)
             return -1;
         }
 
-        uint8_t buffer[4 * KB];
-        int nread = read(fd, buffer, 4 * KB);
-        if (nread < 0) {
+        struct stat stat { };
+        if (fstat(fd, &stat) < 0) {
             perror("cat");
             return -1;
         }
 
-        int nwritten = write(STDOUT_FILENO, buffer, nread);
+        if (stat.st_size == 0) {
+            continue;
+        }
+
+        // Map the file straight from the page cache instead of copying it through read()
+        void* contents = mmap(nullptr, stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (contents == MAP_FAILED) {
+            perror("cat");
+            return -1;
+        }
+
+        int nwritten = write(STDOUT_FILENO, contents, stat.st_size);
+        munmap(contents, stat.st_size);
         if (nwritten < 0) {
             perror("cat");
             return -1;
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2025, Jason Long <jasonlongball@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Forks and execs itself over and over, then checks that every page the kernel
+// used for those processes was given back
+static constexpr size_t kWarmupIterations = 100;
+static constexpr size_t kIterations = 100000;
+static constexpr size_t kSettleAttempts = 100;
+
+static bool spawn_child(const char* path)
+{
+    pid_t pid = fork();
+    if (pid < 0) {
+        return false;
+    }
+
+    if (pid == 0) {
+        char child_argument[] = "child";
+        char* argv[] = { child_argument, nullptr };
+        execve(path, argv);
+        exit(EXIT_FAILURE);
+    }
+
+    wait(nullptr);
+    return true;
+}
+
+static bool run(const char* path, size_t iterations)
+{
+    for (size_t i = 0; i < iterations; i++) {
+        if (!spawn_child(path)) {
+            printf("forksoak: fork failed after %u iterations\n", i);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && strncmp(argv[1], "child", 6) == 0) {
+        return 0;
+    }
+
+    // Lets the kernel heap and page caches reach their steady state first
+    if (!run(argv[0], kWarmupIterations)) {
+        return EXIT_FAILURE;
+    }
+
+    struct meminfo baseline;
+    meminfo(&baseline);
+
+    if (!run(argv[0], kIterations)) {
+        return EXIT_FAILURE;
+    }
+
+    // Exec'd images are reaped by the scheduler, so give it a few chances to catch up
+    struct meminfo after;
+    for (size_t attempt = 0; attempt < kSettleAttempts; attempt++) {
+        meminfo(&after);
+        if (after.kernel_pages_free >= baseline.kernel_pages_free && after.user_pages_free >= baseline.user_pages_free) {
+            break;
+        }
+
+        for (volatile size_t spin = 0; spin < 1000000; spin++) { }
+    }
+
+    printf("forksoak: %u fork/exec cycles\n", kIterations);
+    printf("  Kernel pages free: %u before, %u after\n", baseline.kernel_pages_free, after.kernel_pages_free);
+    printf("  User pages free:   %u before, %u after\n", baseline.user_pages_free, after.user_pages_free);
+
+    if (after.kernel_pages_free < baseline.kernel_pages_free || after.user_pages_free < baseline.user_pages_free) {
+        printf("forksoak: pages leaked\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
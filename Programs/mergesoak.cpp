@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2025, Jason Long <jasonlongball@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+// Fills anonymous memory with a handful of distinct pages, waits for the kernel to merge the
+// copies, then writes to every page and checks that each one was split back out intact
+static constexpr size_t kPageSize = 4096;
+static constexpr size_t kWorkingSetLength = 16 * 1024 * 1024;
+static constexpr size_t kPageCount = kWorkingSetLength / kPageSize;
+static constexpr size_t kDistinctPages = 4;
+static constexpr size_t kSettleAttempts = 200;
+
+static unsigned pattern(size_t page, size_t word)
+{
+    return ((page % kDistinctPages) * 2654435761u) ^ word;
+}
+
+static size_t count_bad_pages(unsigned* memory, unsigned extra)
+{
+    size_t bad_pages = 0;
+    for (size_t page = 0; page < kPageCount; page++) {
+        unsigned* words = memory + page * (kPageSize / sizeof(unsigned));
+        for (size_t word = 0; word < kPageSize / sizeof(unsigned); word++) {
+            unsigned expected = pattern(page, word) + (word == 0 ? extra * page : 0);
+            if (words[word] != expected) {
+                bad_pages++;
+                break;
+            }
+        }
+    }
+    return bad_pages;
+}
+
+int main()
+{
+    struct meminfo before;
+    meminfo(&before);
+
+    auto* memory = static_cast<unsigned*>(mmap(nullptr, kWorkingSetLength, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, 0, 0));
+    if (memory == MAP_FAILED) {
+        printf("mergesoak: mmap of %u MiB failed\n", kWorkingSetLength / (1024 * 1024));
+        return EXIT_FAILURE;
+    }
+
+    for (size_t page = 0; page < kPageCount; page++) {
+        unsigned* words = memory + page * (kPageSize / sizeof(unsigned));
+        for (size_t word = 0; word < kPageSize / sizeof(unsigned); word++) {
+            words[word] = pattern(page, word);
+        }
+    }
+
+    // Pages are only merged once they have stopped changing for a whole scan, so give it a few
+    struct meminfo merged;
+    for (size_t attempt = 0; attempt < kSettleAttempts; attempt++) {
+        meminfo(&merged);
+        if (merged.merged_pages_saved >= before.merged_pages_saved + kPageCount - kDistinctPages) {
+            break;
+        }
+
+        for (volatile size_t spin = 0; spin < 1000000; spin++) { }
+    }
+
+    size_t bad_merged_pages = count_bad_pages(memory, 0);
+
+    // Every write has to copy the page away from the others that share it
+    for (size_t page = 0; page < kPageCount; page++) {
+        memory[page * (kPageSize / sizeof(unsigned))] += page;
+    }
+    size_t bad_split_pages = count_bad_pages(memory, 1);
+
+    munmap(memory, kWorkingSetLength);
+
+    printf("mergesoak: %u pages with %u distinct contents\n", kPageCount, kDistinctPages);
+    printf("  Pages saved: %u before, %u once merged\n", before.merged_pages_saved, merged.merged_pages_saved);
+    printf("  Frames shared: %u before, %u once merged\n", before.merged_pages_shared, merged.merged_pages_shared);
+
+    if (bad_merged_pages != 0 || bad_split_pages != 0) {
+        printf("mergesoak: %u merged and %u split pages came back corrupted\n", bad_merged_pages, bad_split_pages);
+        return EXIT_FAILURE;
+    }
+
+    if (merged.merged_pages_saved <= before.merged_pages_saved) {
+        printf("mergesoak: nothing was merged\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
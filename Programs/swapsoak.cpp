@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2025, Jason Long <jasonlongball@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+// Touches more anonymous memory than the machine has RAM, then checks that every page
+// still holds what was written to it after the kernel swapped most of them out
+static constexpr size_t kPageSize = 4096;
+static constexpr size_t kWorkingSetLength = 160 * 1024 * 1024;
+static constexpr size_t kPageCount = kWorkingSetLength / kPageSize;
+
+static unsigned pattern(size_t page, size_t word)
+{
+    return (page * 2654435761u) ^ word;
+}
+
+int main()
+{
+    struct meminfo before;
+    meminfo(&before);
+
+    auto* memory = static_cast<unsigned*>(mmap(nullptr, kWorkingSetLength, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, 0, 0));
+    if (memory == MAP_FAILED) {
+        printf("swapsoak: mmap of %u MiB failed\n", kWorkingSetLength / (1024 * 1024));
+        return EXIT_FAILURE;
+    }
+
+    // One word every 256 bytes is enough to tell the pages apart and keeps the run short
+    for (size_t page = 0; page < kPageCount; page++) {
+        unsigned* words = memory + page * (kPageSize / sizeof(unsigned));
+        for (size_t word = 0; word < kPageSize / sizeof(unsigned); word += 64) {
+            words[word] = pattern(page, word);
+        }
+    }
+
+    struct meminfo during;
+    meminfo(&during);
+
+    size_t bad_pages = 0;
+    for (size_t page = 0; page < kPageCount; page++) {
+        unsigned* words = memory + page * (kPageSize / sizeof(unsigned));
+        for (size_t word = 0; word < kPageSize / sizeof(unsigned); word += 64) {
+            if (words[word] != pattern(page, word)) {
+                bad_pages++;
+                break;
+            }
+        }
+    }
+
+    munmap(memory, kWorkingSetLength);
+
+    struct meminfo after;
+    meminfo(&after);
+
+    printf("swapsoak: touched %u pages\n", kPageCount);
+    printf("  Swap pages used: %u before, %u at peak, %u after\n", before.swap_pages_total - before.swap_pages_free, during.swap_pages_total - during.swap_pages_free, after.swap_pages_total - after.swap_pages_free);
+    printf("  Compressed in memory at peak: %u pages in %u KiB\n", during.compressed_swap_pages, during.compressed_swap_bytes / 1024);
+
+    if (bad_pages != 0) {
+        printf("swapsoak: %u pages came back corrupted\n", bad_pages);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
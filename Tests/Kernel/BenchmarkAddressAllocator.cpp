@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2025, Jason Long <jasonlongball@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <Kernel/Memory/AddressAllocator.h>
+#include <Kernel/Memory/PagingTypes.h>
+#include <Universal/ArrayList.h>
+#include <chrono>
+#include <iostream>
+
+// The ArrayList based allocator that AddressAllocator replaced, kept as the baseline
+class LinearAddressAllocator {
+public:
+    LinearAddressAllocator(VirtualAddress base, size_t length)
+    {
+        m_ranges.add_last(AddressRange(base, length));
+    }
+
+    Expected<AddressRange> allocate(size_t length)
+    {
+        length = Memory::page_round_up(length);
+
+        int i;
+        for (i = 0; i < m_ranges.size(); i++) {
+            if (length <= m_ranges[i].length()) {
+                break;
+            }
+        }
+
+        if (i >= m_ranges.size()) {
+            return Result(Status::Failure);
+        }
+
+        AddressRange address_range_found = m_ranges[i];
+        m_ranges.remove(i);
+
+        if (address_range_found.length() == length) {
+            return address_range_found;
+        }
+
+        m_ranges.add(i, AddressRange(address_range_found.lower().offset(length), address_range_found.length() - length));
+        return AddressRange(address_range_found.lower(), length);
+    }
+
+    Result free(AddressRange address_range)
+    {
+        for (int i = 0; i < m_ranges.size(); i++) {
+            if (m_ranges[i].upper() == address_range.lower()) {
+                m_ranges[i].add_length(address_range.length());
+                goto merge;
+            }
+        }
+        m_ranges.add_last(address_range);
+
+    merge:
+        m_ranges.sort([&](auto& a, auto& b) {
+            return a.lower() > b.lower();
+        });
+
+        ArrayList<AddressRange> merged_ranges;
+        for (int i = 0; i < m_ranges.size(); i++) {
+            if (merged_ranges.is_empty()) {
+                merged_ranges.add_last(m_ranges[i]);
+                continue;
+            }
+
+            if (m_ranges[i].lower() == merged_ranges.last().upper()) {
+                merged_ranges.last().add_length(m_ranges[i].length());
+                continue;
+            }
+
+            merged_ranges.add_last(m_ranges[i]);
+        }
+
+        m_ranges = move(merged_ranges);
+        return Status::OK;
+    }
+
+private:
+    ArrayList<AddressRange> m_ranges;
+};
+
+static constexpr size_t kLiveRanges = 1024;
+static constexpr size_t kIterations = 20000;
+
+// Keeps kLiveRanges regions of 1 to 16 pages alive and replaces a random one every iteration
+template<typename Allocator>
+static double run_churn()
+{
+    Allocator allocator(Memory::kUserVirtualBase, Memory::kUserVirtualLength);
+    AddressRange live_ranges[kLiveRanges];
+
+    u32 seed = 1;
+    auto random = [&]() {
+        seed = seed * 1103515245 + 12345;
+        return seed >> 16;
+    };
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < kLiveRanges; i++) {
+        live_ranges[i] = allocator.allocate((random() % 16 + 1) * Memory::kPageSize).release_value();
+    }
+
+    for (size_t i = 0; i < kIterations; i++) {
+        size_t index = random() % kLiveRanges;
+        allocator.free(live_ranges[index]);
+        live_ranges[index] = allocator.allocate((random() % 16 + 1) * Memory::kPageSize).release_value();
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main(void)
+{
+    double linear_time = run_churn<LinearAddressAllocator>();
+    double tree_time = run_churn<AddressAllocator>();
+
+    std::cout << "BenchmarkAddressAllocator: " << kLiveRanges << " live ranges, " << kIterations << " free/allocate pairs\n";
+    std::cout << "  ArrayList allocator:      " << linear_time << " ms\n";
+    std::cout << "  Red-black tree allocator: " << tree_time << " ms\n";
+    std::cout << "  Speedup: " << linear_time / tree_time << "x\n";
+}
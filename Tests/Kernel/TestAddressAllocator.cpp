@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2025, Jason Long <jasonlongball@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <Kernel/Memory/AddressAllocator.h>
+#include <Kernel/Memory/PagingTypes.h>
+#include <Tests/Macros.h>
+
+static constexpr u32 kBase = 0x01000000;
+static constexpr u32 kPage = Memory::kPageSize;
+
+TEST_CASE(allocate)
+{
+    AddressAllocator allocator(kBase, 16 * kPage);
+
+    auto first = allocator.allocate(100);
+    CHECK_TRUE(first.is_ok());
+    CHECK_EQUAL(kBase, first.value().lower().get());
+    CHECK_EQUAL((size_t)kPage, first.value().length());
+
+    auto second = allocator.allocate(2 * kPage);
+    CHECK_TRUE(second.is_ok());
+    CHECK_EQUAL(kBase + kPage, second.value().lower().get());
+
+    CHECK_TRUE(allocator.allocate(14 * kPage).is_error());
+    CHECK_TRUE(allocator.allocate(13 * kPage).is_ok());
+    CHECK_TRUE(allocator.allocate(kPage).is_error());
+    CHECK_TRUE(allocator.allocate(0).is_error());
+}
+
+TEST_CASE(allocate_best_fit)
+{
+    AddressAllocator allocator(kBase, 16 * kPage);
+
+    auto a = allocator.allocate(kPage).release_value();
+    auto b = allocator.allocate(4 * kPage).release_value();
+    auto c = allocator.allocate(kPage).release_value();
+    auto d = allocator.allocate(2 * kPage).release_value();
+    auto e = allocator.allocate(kPage).release_value();
+    (void)a;
+    (void)c;
+    (void)e;
+
+    // Leaves holes of 4 pages, 2 pages and the 7 page tail
+    CHECK_TRUE(allocator.free(b).is_ok());
+    CHECK_TRUE(allocator.free(d).is_ok());
+    CHECK_EQUAL((size_t)3, allocator.free_range_count());
+
+    auto fit = allocator.allocate(2 * kPage);
+    CHECK_TRUE(fit.is_ok());
+    CHECK_EQUAL(d.lower().get(), fit.value().lower().get());
+
+    fit = allocator.allocate(3 * kPage);
+    CHECK_TRUE(fit.is_ok());
+    CHECK_EQUAL(b.lower().get(), fit.value().lower().get());
+}
+
+TEST_CASE(allocate_at)
+{
+    AddressAllocator allocator(kBase, 16 * kPage);
+
+    auto middle = allocator.allocate_at(kBase + 4 * kPage, 2 * kPage);
+    CHECK_TRUE(middle.is_ok());
+    CHECK_EQUAL(kBase + 4 * kPage, middle.value().lower().get());
+    CHECK_EQUAL((size_t)2, allocator.free_range_count());
+
+    CHECK_TRUE(allocator.allocate_at(kBase + 5 * kPage, kPage).is_error());
+    CHECK_TRUE(allocator.allocate_at(kBase + 3 * kPage, 2 * kPage).is_error());
+    CHECK_TRUE(allocator.allocate_at(kBase + 15 * kPage, 2 * kPage).is_error());
+    CHECK_TRUE(allocator.allocate_at(kBase - kPage, kPage).is_error());
+
+    CHECK_TRUE(allocator.allocate_at(kBase, 4 * kPage).is_ok());
+    CHECK_EQUAL((size_t)1, allocator.free_range_count());
+    CHECK_TRUE(allocator.allocate_at(kBase + 6 * kPage, 10 * kPage).is_ok());
+    CHECK_EQUAL((size_t)0, allocator.free_range_count());
+}
+
+TEST_CASE(allocate_aligned)
+{
+    static constexpr u32 kAlignment = 4 * kPage;
+    AddressAllocator allocator(kBase + kPage, 16 * kPage);
+
+    auto first = allocator.allocate_aligned(kPage, kAlignment);
+    CHECK_TRUE(first.is_ok());
+    CHECK_EQUAL(kBase + kAlignment, first.value().lower().get());
+
+    // The pages skipped for alignment are still free
+    CHECK_EQUAL((size_t)2, allocator.free_range_count());
+    auto skipped = allocator.allocate_at(kBase + kPage, 3 * kPage);
+    CHECK_TRUE(skipped.is_ok());
+
+    auto second = allocator.allocate_aligned(2 * kAlignment, kAlignment);
+    CHECK_TRUE(second.is_ok());
+    CHECK_EQUAL(kBase + 2 * kAlignment, second.value().lower().get());
+
+    CHECK_TRUE(allocator.allocate_aligned(2 * kAlignment, kAlignment).is_error());
+    CHECK_TRUE(allocator.allocate_aligned(kPage, kPage + 1).is_error());
+}
+
+TEST_CASE(free_coalesces)
+{
+    AddressAllocator allocator(kBase, 8 * kPage);
+
+    AddressRange ranges[8];
+    for (int i = 0; i < 8; i++) {
+        ranges[i] = allocator.allocate(kPage).release_value();
+    }
+    CHECK_EQUAL((size_t)0, allocator.free_range_count());
+
+    for (int i = 0; i < 8; i += 2) {
+        CHECK_TRUE(allocator.free(ranges[i]).is_ok());
+    }
+    CHECK_EQUAL((size_t)4, allocator.free_range_count());
+
+    for (int i = 1; i < 8; i += 2) {
+        CHECK_TRUE(allocator.free(ranges[i]).is_ok());
+    }
+    CHECK_EQUAL((size_t)1, allocator.free_range_count());
+
+    auto whole = allocator.allocate(8 * kPage);
+    CHECK_TRUE(whole.is_ok());
+    CHECK_EQUAL(kBase, whole.value().lower().get());
+}
+
+TEST_CASE(free_rejects_free_memory)
+{
+    AddressAllocator allocator(kBase, 8 * kPage);
+
+    auto range = allocator.allocate(2 * kPage).release_value();
+    CHECK_TRUE(allocator.free(range).is_ok());
+    CHECK_TRUE(allocator.free(range).is_error());
+    CHECK_TRUE(allocator.free(AddressRange(kBase + kPage, 2 * kPage)).is_error());
+    CHECK_EQUAL((size_t)1, allocator.free_range_count());
+}
+
+TEST_MAIN(TestAddressAllocator, [&]() {
+    ENUMERATE_TEST(allocate);
+    ENUMERATE_TEST(allocate_best_fit);
+    ENUMERATE_TEST(allocate_at);
+    ENUMERATE_TEST(allocate_aligned);
+    ENUMERATE_TEST(free_coalesces);
+    ENUMERATE_TEST(free_rejects_free_memory);
+})
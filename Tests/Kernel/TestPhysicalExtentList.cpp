@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2025, Jason Long <jasonlongball@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <Kernel/Memory/PhysicalExtentList.h>
+#include <Tests/Macros.h>
+
+static constexpr u32 kBase = 0x00400000;
+static constexpr u32 kPage = Memory::kPageSize;
+
+TEST_CASE(contiguous)
+{
+    PhysicalExtentList extents(1024);
+    CHECK_EQUAL((size_t)0, extents.extent_count());
+    CHECK_FALSE(extents.is_backed(0));
+
+    extents.set_pages(0, kBase, 1024);
+    CHECK_EQUAL((size_t)1, extents.extent_count());
+    CHECK_EQUAL(kBase, extents.page(0).get());
+    CHECK_EQUAL(kBase + 1023 * kPage, extents.page(1023).get());
+}
+
+TEST_CASE(set_page_merges)
+{
+    PhysicalExtentList extents(8);
+
+    extents.set_page(0, kBase);
+    extents.set_page(2, kBase + 2 * kPage);
+    CHECK_EQUAL((size_t)2, extents.extent_count());
+    CHECK_FALSE(extents.is_backed(1));
+
+    extents.set_page(1, kBase + kPage);
+    CHECK_EQUAL((size_t)1, extents.extent_count());
+    CHECK_EQUAL(kBase + kPage, extents.page(1).get());
+
+    // A page that is not physically adjacent starts its own extent
+    extents.set_page(3, kBase + 16 * kPage);
+    CHECK_EQUAL((size_t)2, extents.extent_count());
+    CHECK_EQUAL(kBase + 16 * kPage, extents.page(3).get());
+}
+
+TEST_CASE(set_page_splits)
+{
+    PhysicalExtentList extents(8);
+    extents.set_pages(0, kBase, 8);
+
+    extents.set_page(4, kBase + 32 * kPage);
+    CHECK_EQUAL((size_t)3, extents.extent_count());
+    CHECK_EQUAL(kBase + 3 * kPage, extents.page(3).get());
+    CHECK_EQUAL(kBase + 32 * kPage, extents.page(4).get());
+    CHECK_EQUAL(kBase + 5 * kPage, extents.page(5).get());
+
+    extents.set_page(4, kBase + 4 * kPage);
+    CHECK_EQUAL((size_t)1, extents.extent_count());
+
+    extents.set_page(0, PhysicalAddress());
+    extents.set_page(7, PhysicalAddress());
+    CHECK_EQUAL((size_t)1, extents.extent_count());
+    CHECK_FALSE(extents.is_backed(0));
+    CHECK_FALSE(extents.is_backed(7));
+    CHECK_EQUAL(kBase + kPage, extents.page(1).get());
+    CHECK_EQUAL(kBase + 6 * kPage, extents.page(6).get());
+}
+
+TEST_CASE(for_each_extent)
+{
+    PhysicalExtentList extents(16);
+    for (size_t i = 0; i < 16; i += 2) {
+        extents.set_page(i, kBase + i * 2 * kPage);
+    }
+    CHECK_EQUAL((size_t)8, extents.extent_count());
+
+    size_t pages = 0;
+    size_t previous_end = 0;
+    extents.for_each_extent([&](const PhysicalExtent& extent) {
+        CHECK_TRUE(extent.first_page >= previous_end);
+        previous_end = extent.end_page();
+        pages += extent.count;
+    });
+    CHECK_EQUAL((size_t)8, pages);
+}
+
+TEST_CASE(resize)
+{
+    PhysicalExtentList extents(8);
+    extents.set_pages(0, kBase, 8);
+
+    extents.resize(5);
+    CHECK_EQUAL((size_t)5, extents.page_count());
+    CHECK_EQUAL((size_t)1, extents.extent_count());
+    extents.for_each_extent([&](const PhysicalExtent& extent) {
+        CHECK_EQUAL((size_t)5, extent.count);
+    });
+
+    // Grown pages are unbacked until they are set
+    extents.resize(12);
+    CHECK_FALSE(extents.is_backed(5));
+    CHECK_FALSE(extents.is_backed(11));
+    extents.set_page(11, kBase + 11 * kPage);
+    CHECK_EQUAL((size_t)2, extents.extent_count());
+
+    extents.clear_pages(2, 10);
+    CHECK_EQUAL((size_t)1, extents.extent_count());
+    CHECK_EQUAL(kBase + kPage, extents.page(1).get());
+    CHECK_FALSE(extents.is_backed(2));
+}
+
+TEST_CASE(sparse_faults)
+{
+    static constexpr size_t kPageCount = 4096;
+    PhysicalExtentList extents(kPageCount);
+
+    // Fault in every other page in a scattered order, none of them physically adjacent
+    auto physical_page = [](size_t page_index) { return kBase + page_index * 2 * kPage; };
+    for (size_t i = 0; i < kPageCount / 2; i++) {
+        size_t page_index = ((i * 769) % (kPageCount / 2)) * 2;
+        extents.set_page(page_index, physical_page(page_index));
+    }
+    CHECK_EQUAL(kPageCount / 2, extents.extent_count());
+
+    for (size_t page_index = 0; page_index < kPageCount; page_index++) {
+        if (page_index % 2 == 0) {
+            CHECK_EQUAL(physical_page(page_index), extents.page(page_index).get());
+        } else {
+            CHECK_FALSE(extents.is_backed(page_index));
+        }
+    }
+
+    // Filling the gaps from the same scattered allocation keeps every page separate
+    for (size_t page_index = 1; page_index < kPageCount; page_index += 2) {
+        extents.set_page(page_index, physical_page(page_index));
+    }
+    CHECK_EQUAL(kPageCount, extents.extent_count());
+
+    extents.clear_pages(0, kPageCount / 2);
+    CHECK_EQUAL(kPageCount / 2, extents.extent_count());
+    CHECK_FALSE(extents.is_backed(kPageCount / 2 - 1));
+    CHECK_EQUAL(physical_page(kPageCount / 2), extents.page(kPageCount / 2).get());
+
+    extents.resize(kPageCount / 2 + 1);
+    CHECK_EQUAL((size_t)1, extents.extent_count());
+    CHECK_EQUAL(physical_page(kPageCount / 2), extents.page(kPageCount / 2).get());
+}
+
+TEST_CASE(sparse_extents)
+{
+    static constexpr size_t kPageCount = 4096;
+    PhysicalExtentList extents(kPageCount);
+
+    // A handful of runs set out of order stays far below the cost of a flat array
+    for (size_t i = 0; i < 16; i++) {
+        size_t first_page = ((i * 7) % 16) * 256;
+        extents.set_pages(first_page, kBase + first_page * 2 * kPage, 128);
+    }
+    CHECK_EQUAL((size_t)16, extents.extent_count());
+
+    size_t previous_end = 0;
+    extents.for_each_extent([&](const PhysicalExtent& extent) {
+        CHECK_TRUE(extent.first_page >= previous_end);
+        CHECK_EQUAL((size_t)128, extent.count);
+        previous_end = extent.end_page();
+    });
+
+    CHECK_EQUAL(kBase + 2 * 256 * kPage, extents.page(256).get());
+    CHECK_EQUAL(kBase + (2 * 256 + 127) * kPage, extents.page(383).get());
+    CHECK_FALSE(extents.is_backed(384));
+
+    // Punching a hole splits a run in two
+    extents.clear_pages(300, 10);
+    CHECK_EQUAL((size_t)17, extents.extent_count());
+    CHECK_FALSE(extents.is_backed(305));
+    CHECK_EQUAL(kBase + (2 * 256 + 54) * kPage, extents.page(310).get());
+
+    extents.set_pages(300, kBase + (2 * 256 + 44) * kPage, 10);
+    CHECK_EQUAL((size_t)16, extents.extent_count());
+}
+
+TEST_MAIN(TestPhysicalExtentList, [&]() {
+    ENUMERATE_TEST(contiguous);
+    ENUMERATE_TEST(set_page_merges);
+    ENUMERATE_TEST(set_page_splits);
+    ENUMERATE_TEST(for_each_extent);
+    ENUMERATE_TEST(resize);
+    ENUMERATE_TEST(sparse_faults);
+    ENUMERATE_TEST(sparse_extents);
+})
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2025, Jason Long <jasonlongball@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <Tests/Macros.h>
+#include <Universal/LZ.h>
+
+static constexpr size_t kPage = 4096;
+
+static bool round_trips(const u8* input, size_t length, size_t* compressed_length = nullptr)
+{
+    static u8 compressed[2 * kPage];
+    static u8 decompressed[kPage];
+
+    size_t written = LZ::compress(input, length, compressed, sizeof(compressed));
+    if (compressed_length != nullptr) {
+        *compressed_length = written;
+    }
+    if (written == 0 || !LZ::decompress(compressed, written, decompressed, length)) {
+        return false;
+    }
+    return memcmp(input, decompressed, length) == 0;
+}
+
+TEST_CASE(zeroed_page)
+{
+    u8 page[kPage] = {};
+
+    size_t compressed_length;
+    CHECK_TRUE(round_trips(page, kPage, &compressed_length));
+    CHECK_TRUE(compressed_length < 64);
+}
+
+TEST_CASE(repeating_text)
+{
+    const char* line = "the quick brown fox jumps over the lazy dog ";
+    u8 page[kPage];
+    for (size_t i = 0; i < kPage; i++) {
+        page[i] = line[i % strlen(line)];
+    }
+
+    size_t compressed_length;
+    CHECK_TRUE(round_trips(page, kPage, &compressed_length));
+    CHECK_TRUE(compressed_length < kPage / 8);
+}
+
+TEST_CASE(random_data)
+{
+    u8 page[kPage];
+    u32 seed = 1;
+    for (size_t i = 0; i < kPage; i++) {
+        seed = seed * 1103515245 + 12345;
+        page[i] = seed >> 16;
+    }
+
+    // Incompressible data still round trips when there is room, and is refused when there is not
+    CHECK_TRUE(round_trips(page, kPage));
+
+    u8 compressed[kPage];
+    CHECK_EQUAL((size_t)0, LZ::compress(page, kPage, compressed, kPage * 3 / 4));
+}
+
+TEST_CASE(short_inputs)
+{
+    const u8 input[] = { 1, 2, 3, 1, 2, 3, 1, 2, 3 };
+    for (size_t length = 0; length <= sizeof(input); length++) {
+        CHECK_TRUE(round_trips(input, length));
+    }
+}
+
+TEST_CASE(long_lengths)
+{
+    // Literal and match lengths past 255 need several continuation bytes
+    u8 page[kPage];
+    u32 seed = 7;
+    for (size_t i = 0; i < 600; i++) {
+        seed = seed * 1103515245 + 12345;
+        page[i] = seed >> 16;
+    }
+    memset(page + 600, 0xaa, kPage - 600);
+
+    CHECK_TRUE(round_trips(page, kPage));
+}
+
+TEST_CASE(rejects_malformed_input)
+{
+    u8 page[kPage] = {};
+    u8 compressed[kPage];
+    u8 output[kPage];
+    size_t length = LZ::compress(page, kPage, compressed, sizeof(compressed));
+    CHECK_TRUE(length > 0);
+
+    CHECK_FALSE(LZ::decompress(compressed, length / 2, output, kPage));
+    CHECK_FALSE(LZ::decompress(compressed, length, output, kPage - 1));
+
+    // A match reaching back before the start of the output
+    const u8 bad_offset[] = { 0x10, 0xff, 0x02, 0x00, 0x00 };
+    CHECK_FALSE(LZ::decompress(bad_offset, sizeof(bad_offset), output, kPage));
+}
+
+TEST_MAIN(TestLZ, [&]() {
+    ENUMERATE_TEST(zeroed_page);
+    ENUMERATE_TEST(repeating_text);
+    ENUMERATE_TEST(random_data);
+    ENUMERATE_TEST(short_inputs);
+    ENUMERATE_TEST(long_lengths);
+    ENUMERATE_TEST(rejects_malformed_input);
+})
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2025, Jason Long <jasonlongball@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <Tests/Macros.h>
+#include <Universal/RedBlackTree.h>
+
+TEST_CASE(create)
+{
+    RedBlackTree<u32, u32> tree;
+    CHECK_TRUE(tree.is_empty());
+    CHECK_EQUAL((size_t)0, tree.size());
+    CHECK_NULL(tree.first());
+    CHECK_NULL(tree.last());
+}
+
+TEST_CASE(insert_and_find)
+{
+    RedBlackTree<u32, u32> tree;
+    CHECK_NONNULL(tree.insert(20, 200));
+    CHECK_NONNULL(tree.insert(10, 100));
+    CHECK_NONNULL(tree.insert(30, 300));
+    CHECK_EQUAL((size_t)3, tree.size());
+
+    CHECK_NULL(tree.insert(20, 0));
+    CHECK_EQUAL((size_t)3, tree.size());
+
+    CHECK_EQUAL((u32)100, tree.find(10)->value());
+    CHECK_EQUAL((u32)200, tree.find(20)->value());
+    CHECK_EQUAL((u32)300, tree.find(30)->value());
+    CHECK_NULL(tree.find(15));
+
+    tree.find(20)->value() = 250;
+    CHECK_EQUAL((u32)250, tree.find(20)->value());
+}
+
+TEST_CASE(in_order)
+{
+    RedBlackTree<u32, u32> tree;
+    for (u32 i = 0; i < 100; i++) {
+        tree.insert((i * 37) % 100, i);
+    }
+    CHECK_EQUAL((size_t)100, tree.size());
+
+    u32 expected = 0;
+    for (auto* node = tree.first(); node != nullptr; node = RedBlackTree<u32, u32>::next(node)) {
+        CHECK_EQUAL(expected++, node->key());
+    }
+    CHECK_EQUAL((u32)100, expected);
+
+    for (auto* node = tree.last(); node != nullptr; node = RedBlackTree<u32, u32>::previous(node)) {
+        CHECK_EQUAL(--expected, node->key());
+    }
+    CHECK_EQUAL((u32)0, expected);
+}
+
+TEST_CASE(bounds)
+{
+    RedBlackTree<u32, u32> tree;
+    tree.insert(10, 0);
+    tree.insert(20, 0);
+    tree.insert(30, 0);
+
+    CHECK_NULL(tree.find_largest_not_above(5));
+    CHECK_EQUAL((u32)10, tree.find_largest_not_above(10)->key());
+    CHECK_EQUAL((u32)10, tree.find_largest_not_above(19)->key());
+    CHECK_EQUAL((u32)30, tree.find_largest_not_above(100)->key());
+
+    CHECK_EQUAL((u32)10, tree.find_smallest_not_below(5)->key());
+    CHECK_EQUAL((u32)20, tree.find_smallest_not_below(11)->key());
+    CHECK_EQUAL((u32)30, tree.find_smallest_not_below(30)->key());
+    CHECK_NULL(tree.find_smallest_not_below(31));
+}
+
+TEST_CASE(remove)
+{
+    RedBlackTree<u32, u32> tree;
+    for (u32 i = 0; i < 1000; i++) {
+        tree.insert((i * 7919) % 1000, i);
+    }
+
+    for (u32 i = 0; i < 1000; i += 2) {
+        tree.remove(tree.find(i));
+    }
+    CHECK_EQUAL((size_t)500, tree.size());
+
+    u32 expected = 1;
+    for (auto* node = tree.first(); node != nullptr; node = RedBlackTree<u32, u32>::next(node)) {
+        CHECK_EQUAL(expected, node->key());
+        expected += 2;
+    }
+    CHECK_EQUAL((u32)1001, expected);
+
+    for (u32 i = 1; i < 1000; i += 2) {
+        tree.remove(tree.find(i));
+    }
+    CHECK_TRUE(tree.is_empty());
+    CHECK_NULL(tree.first());
+}
+
+TEST_CASE(churn)
+{
+    RedBlackTree<u32, u32> tree;
+    bool present[512] = {};
+    size_t expected_size = 0;
+
+    u32 seed = 1;
+    for (u32 i = 0; i < 20000; i++) {
+        seed = seed * 1103515245 + 12345;
+        u32 key = (seed >> 16) % 512;
+
+        if (present[key]) {
+            tree.remove(tree.find(key));
+            expected_size--;
+        } else {
+            tree.insert(key, key);
+            expected_size++;
+        }
+        present[key] = !present[key];
+    }
+
+    CHECK_EQUAL(expected_size, tree.size());
+    for (u32 key = 0; key < 512; key++) {
+        CHECK_EQUAL(present[key], tree.find(key) != nullptr);
+    }
+
+    size_t count = 0;
+    u32 previous_key = 0;
+    for (auto* node = tree.first(); node != nullptr; node = RedBlackTree<u32, u32>::next(node)) {
+        if (count > 0) {
+            CHECK_TRUE(previous_key < node->key());
+        }
+        previous_key = node->key();
+        count++;
+    }
+    CHECK_EQUAL(expected_size, count);
+}
+
+TEST_MAIN(TestRedBlackTree, [&]() {
+    ENUMERATE_TEST(create);
+    ENUMERATE_TEST(insert_and_find);
+    ENUMERATE_TEST(in_order);
+    ENUMERATE_TEST(bounds);
+    ENUMERATE_TEST(remove);
+    ENUMERATE_TEST(churn);
+})
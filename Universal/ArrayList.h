@@ -29,12 +29,12 @@ public:
 
     {
         if (is_inlined()) {
-            memcpy(data(), other.data(), sizeof(m_inline_data));
+            Universal::memcpy(data(), other.data(), sizeof(m_inline_data));
         } else {
             m_data = other.m_data;
         }
 
-        memset(other.m_inline_data, 0, sizeof(other.m_inline_data));
+        Universal::memset(other.m_inline_data, 0, sizeof(other.m_inline_data));
         other.m_data = nullptr;
         other.m_capacity = 0;
         other.m_size = 0;
@@ -49,12 +49,12 @@ public:
             m_capacity = other.m_capacity;
 
             if (is_inlined()) {
-                memcpy(data(), other.data(), sizeof(m_inline_data));
+                Universal::memcpy(data(), other.data(), sizeof(m_inline_data));
             } else {
                 m_data = other.m_data;
             }
 
-            memset(other.m_inline_data, 0, sizeof(other.m_inline_data));
+            Universal::memset(other.m_inline_data, 0, sizeof(other.m_inline_data));
             other.m_data = nullptr;
             other.m_capacity = 0;
             other.m_size = 0;
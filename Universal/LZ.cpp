@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2025, Jason Long <jasonlongball@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <Universal/LZ.h>
+#include <Universal/Number.h>
+#include <Universal/Stdlib.h>
+
+namespace Universal::LZ {
+
+static constexpr size_t kMinMatchLength = 4;
+static constexpr u32 kHashBits = 10;
+static constexpr u8 kLengthMask = 0xf;
+
+static u32 read_u32(const u8* data)
+{
+    u32 value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static u32 hash(u32 sequence)
+{
+    return (sequence * 2654435761u) >> (32 - kHashBits);
+}
+
+// Lengths that do not fit in the token continue in bytes of 255 and end with a smaller one
+static bool write_length(u8* output, size_t output_capacity, size_t& output_position, size_t length)
+{
+    if (length < kLengthMask) {
+        return true;
+    }
+
+    length -= kLengthMask;
+    while (true) {
+        if (output_position >= output_capacity) {
+            return false;
+        }
+
+        u8 byte = length >= 0xff ? 0xff : length;
+        output[output_position++] = byte;
+        length -= byte;
+        if (byte != 0xff) {
+            return true;
+        }
+    }
+}
+
+static bool read_length(const u8* input, size_t input_length, size_t& input_position, size_t& length)
+{
+    if (length < kLengthMask) {
+        return true;
+    }
+
+    while (true) {
+        if (input_position >= input_length) {
+            return false;
+        }
+
+        u8 byte = input[input_position++];
+        length += byte;
+        if (byte != 0xff) {
+            return true;
+        }
+    }
+}
+
+// A match length of 0 writes the last sequence, which has literals only
+static bool write_sequence(u8* output, size_t output_capacity, size_t& output_position, const u8* literals, size_t literal_length, size_t offset, size_t match_length)
+{
+    if (output_position >= output_capacity) {
+        return false;
+    }
+
+    size_t match_code = match_length != 0 ? match_length - kMinMatchLength : 0;
+    output[output_position++] = (min(literal_length, (size_t)kLengthMask) << 4) | min(match_code, (size_t)kLengthMask);
+
+    if (!write_length(output, output_capacity, output_position, literal_length) || literal_length > output_capacity - output_position) {
+        return false;
+    }
+    memcpy(output + output_position, literals, literal_length);
+    output_position += literal_length;
+
+    if (match_length == 0) {
+        return true;
+    }
+
+    if (output_capacity - output_position < 2) {
+        return false;
+    }
+    output[output_position++] = offset & 0xff;
+    output[output_position++] = offset >> 8;
+    return write_length(output, output_capacity, output_position, match_code);
+}
+
+size_t compress(const u8* input, size_t input_length, u8* output, size_t output_capacity)
+{
+    if (input_length > kMaxInputLength) {
+        return 0;
+    }
+
+    // Positions of the last sequence seen for each hash, candidates are checked before use
+    u16 table[1 << kHashBits];
+    memset(table, 0, sizeof(table));
+
+    size_t output_position = 0;
+    size_t anchor = 0;
+    size_t position = 0;
+
+    while (position + kMinMatchLength <= input_length) {
+        u32 sequence = read_u32(input + position);
+        u32 sequence_hash = hash(sequence);
+        size_t candidate = table[sequence_hash];
+        table[sequence_hash] = position;
+
+        if (candidate >= position || read_u32(input + candidate) != sequence) {
+            // Step faster the longer nothing has matched, so incompressible data is skimmed
+            position += 1 + ((position - anchor) >> 6);
+            continue;
+        }
+
+        size_t match_length = kMinMatchLength;
+        while (position + match_length < input_length && input[candidate + match_length] == input[position + match_length]) {
+            match_length++;
+        }
+
+        if (!write_sequence(output, output_capacity, output_position, input + anchor, position - anchor, position - candidate, match_length)) {
+            return 0;
+        }
+
+        position += match_length;
+        anchor = position;
+    }
+
+    if (!write_sequence(output, output_capacity, output_position, input + anchor, input_length - anchor, 0, 0)) {
+        return 0;
+    }
+    return output_position;
+}
+
+bool decompress(const u8* input, size_t input_length, u8* output, size_t output_length)
+{
+    size_t input_position = 0;
+    size_t output_position = 0;
+
+    while (input_position < input_length) {
+        u8 token = input[input_position++];
+
+        size_t literal_length = token >> 4;
+        if (!read_length(input, input_length, input_position, literal_length)) {
+            return false;
+        }
+        if (literal_length > input_length - input_position || literal_length > output_length - output_position) {
+            return false;
+        }
+        memcpy(output + output_position, input + input_position, literal_length);
+        input_position += literal_length;
+        output_position += literal_length;
+
+        if (input_position == input_length) {
+            break;
+        }
+
+        if (input_length - input_position < 2) {
+            return false;
+        }
+        size_t offset = input[input_position] | (input[input_position + 1] << 8);
+        input_position += 2;
+
+        size_t match_length = token & kLengthMask;
+        if (!read_length(input, input_length, input_position, match_length)) {
+            return false;
+        }
+        match_length += kMinMatchLength;
+
+        if (offset == 0 || offset > output_position || match_length > output_length - output_position) {
+            return false;
+        }
+
+        // Byte by byte, since a match may overlap the bytes it is producing
+        for (size_t i = 0; i < match_length; i++, output_position++) {
+            output[output_position] = output[output_position - offset];
+        }
+    }
+
+    return output_position == output_length;
+}
+
+}
@@ -0,0 +1,27 @@
+/*
+ * Copyright (c) 2025, Jason Long <jasonlongball@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <Universal/Types.h>
+
+// A small LZ77 codec in the style of LZ4, built for speed over ratio. The output is a run of
+// sequences, each a token byte holding the literal and match lengths, the literals, then a
+// two byte offset back into the output. The last sequence has literals only.
+namespace Universal::LZ {
+
+// Inputs are limited to what a two byte offset can reach
+static constexpr size_t kMaxInputLength = 0xffff;
+
+// Returns the compressed length, or 0 when the result does not fit in output_capacity
+size_t compress(const u8* input, size_t input_length, u8* output, size_t output_capacity);
+
+// Returns false unless input is well formed and decompresses to exactly output_length bytes
+bool decompress(const u8* input, size_t input_length, u8* output, size_t output_length);
+
+}
+
+namespace LZ = Universal::LZ;
@@ -41,6 +41,28 @@
             dbgprintf(tag, format, ##__VA_ARGS__);    \
         }
 
+#    define dbgprintln_if(condition, tag, format, ...) \
+        if constexpr (condition) {                     \
+            dbgprintln(tag, format, ##__VA_ARGS__);    \
+        }
+#elif defined(TESTING)
+#    include <stdio.h>
+
+#    define dbgprintf(tag, format, ...)                                                      \
+        do {                                                                                 \
+            printf(FORMAT_BOLD "[Host]:" FORMAT_RESET "%s: " format, tag, ##__VA_ARGS__); \
+        } while (0)
+
+#    define dbgprintln(tag, format, ...)                                                          \
+        do {                                                                                      \
+            printf(FORMAT_BOLD "[Host]:" FORMAT_RESET "%s: " format "\n", tag, ##__VA_ARGS__); \
+        } while (0)
+
+#    define dbgprintf_if(condition, tag, format, ...) \
+        if constexpr (condition) {                    \
+            dbgprintf(tag, format, ##__VA_ARGS__);    \
+        }
+
 #    define dbgprintln_if(condition, tag, format, ...) \
         if constexpr (condition) {                     \
             dbgprintln(tag, format, ##__VA_ARGS__);    \
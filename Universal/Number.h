@@ -40,9 +40,20 @@ inline constexpr T min(T a, T b)
     }
 }
 
+template<typename T>
+inline constexpr T max(T a, T b)
+{
+    if (a >= b) {
+        return a;
+    } else {
+        return b;
+    }
+}
+
 }
 
 using Universal::ceiling_divide;
+using Universal::max;
 using Universal::min;
 using Universal::number_between;
 using Universal::number_between_inclusive;
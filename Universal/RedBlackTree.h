@@ -0,0 +1,430 @@
+/*
+ * Copyright (c) 2025, Jason Long <jasonlongball@gmail.com>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <Universal/Malloc.h>
+#include <Universal/Types.h>
+
+namespace Universal {
+
+template<typename K, typename V>
+class RedBlackTree {
+public:
+    class Node {
+        friend class RedBlackTree;
+
+    public:
+        Node(const K& key, const V& value)
+            : m_key(key)
+            , m_value(value)
+        {
+        }
+
+        const K& key() const { return m_key; }
+        V& value() { return m_value; }
+        const V& value() const { return m_value; }
+
+    private:
+        K m_key;
+        V m_value;
+        bool m_is_red { true };
+        Node* m_parent { nullptr };
+        Node* m_left { nullptr };
+        Node* m_right { nullptr };
+    };
+
+    RedBlackTree() { }
+
+    RedBlackTree(const RedBlackTree&) = delete;
+    RedBlackTree& operator=(const RedBlackTree&) = delete;
+
+    ~RedBlackTree() { clear(); }
+
+    bool is_empty() const { return m_size == 0; }
+    size_t size() const { return m_size; }
+
+    Node* insert(const K&, const V&);
+    void remove(Node*);
+    void clear();
+
+    Node* find(const K&) const;
+    Node* find_largest_not_above(const K&) const;
+    Node* find_smallest_not_below(const K&) const;
+
+    Node* first() const { return m_root != nullptr ? minimum(m_root) : nullptr; }
+    Node* last() const { return m_root != nullptr ? maximum(m_root) : nullptr; }
+
+    static Node* next(Node*);
+    static Node* previous(Node*);
+
+private:
+    static bool is_red(const Node* node) { return node != nullptr && node->m_is_red; }
+
+    static Node* minimum(Node*);
+    static Node* maximum(Node*);
+
+    void rotate_left(Node*);
+    void rotate_right(Node*);
+    void transplant(Node* node, Node* replacement);
+
+    void insert_fixup(Node*);
+    void remove_fixup(Node*, Node* parent);
+
+    void destroy(Node*);
+
+    Node* m_root { nullptr };
+    size_t m_size { 0 };
+};
+
+template<typename K, typename V>
+inline typename RedBlackTree<K, V>::Node* RedBlackTree<K, V>::insert(const K& key, const V& value)
+{
+    Node* parent = nullptr;
+    Node** link = &m_root;
+    while (*link != nullptr) {
+        parent = *link;
+        if (key < parent->m_key) {
+            link = &parent->m_left;
+        } else if (parent->m_key < key) {
+            link = &parent->m_right;
+        } else {
+            return nullptr;
+        }
+    }
+
+    auto* node = new Node(key, value);
+    node->m_parent = parent;
+    *link = node;
+    m_size++;
+
+    insert_fixup(node);
+    return node;
+}
+
+template<typename K, typename V>
+inline void RedBlackTree<K, V>::remove(Node* node)
+{
+    Node* child;
+    Node* child_parent;
+    bool removed_red;
+
+    if (node->m_left == nullptr || node->m_right == nullptr) {
+        child = node->m_left != nullptr ? node->m_left : node->m_right;
+        child_parent = node->m_parent;
+        removed_red = node->m_is_red;
+        transplant(node, child);
+    } else {
+        // Splice the in-order successor into the place of the node being removed
+        Node* successor = minimum(node->m_right);
+        removed_red = successor->m_is_red;
+        child = successor->m_right;
+
+        if (successor->m_parent == node) {
+            child_parent = successor;
+        } else {
+            child_parent = successor->m_parent;
+            transplant(successor, successor->m_right);
+            successor->m_right = node->m_right;
+            successor->m_right->m_parent = successor;
+        }
+
+        transplant(node, successor);
+        successor->m_left = node->m_left;
+        successor->m_left->m_parent = successor;
+        successor->m_is_red = node->m_is_red;
+    }
+
+    delete node;
+    m_size--;
+
+    if (!removed_red) {
+        remove_fixup(child, child_parent);
+    }
+}
+
+template<typename K, typename V>
+inline void RedBlackTree<K, V>::clear()
+{
+    destroy(m_root);
+    m_root = nullptr;
+    m_size = 0;
+}
+
+template<typename K, typename V>
+inline typename RedBlackTree<K, V>::Node* RedBlackTree<K, V>::find(const K& key) const
+{
+    Node* node = m_root;
+    while (node != nullptr) {
+        if (key < node->m_key) {
+            node = node->m_left;
+        } else if (node->m_key < key) {
+            node = node->m_right;
+        } else {
+            return node;
+        }
+    }
+    return nullptr;
+}
+
+template<typename K, typename V>
+inline typename RedBlackTree<K, V>::Node* RedBlackTree<K, V>::find_largest_not_above(const K& key) const
+{
+    Node* found = nullptr;
+    Node* node = m_root;
+    while (node != nullptr) {
+        if (key < node->m_key) {
+            node = node->m_left;
+        } else {
+            found = node;
+            node = node->m_right;
+        }
+    }
+    return found;
+}
+
+template<typename K, typename V>
+inline typename RedBlackTree<K, V>::Node* RedBlackTree<K, V>::find_smallest_not_below(const K& key) const
+{
+    Node* found = nullptr;
+    Node* node = m_root;
+    while (node != nullptr) {
+        if (node->m_key < key) {
+            node = node->m_right;
+        } else {
+            found = node;
+            node = node->m_left;
+        }
+    }
+    return found;
+}
+
+template<typename K, typename V>
+inline typename RedBlackTree<K, V>::Node* RedBlackTree<K, V>::next(Node* node)
+{
+    if (node->m_right != nullptr) {
+        return minimum(node->m_right);
+    }
+
+    Node* parent = node->m_parent;
+    while (parent != nullptr && node == parent->m_right) {
+        node = parent;
+        parent = parent->m_parent;
+    }
+    return parent;
+}
+
+template<typename K, typename V>
+inline typename RedBlackTree<K, V>::Node* RedBlackTree<K, V>::previous(Node* node)
+{
+    if (node->m_left != nullptr) {
+        return maximum(node->m_left);
+    }
+
+    Node* parent = node->m_parent;
+    while (parent != nullptr && node == parent->m_left) {
+        node = parent;
+        parent = parent->m_parent;
+    }
+    return parent;
+}
+
+template<typename K, typename V>
+inline typename RedBlackTree<K, V>::Node* RedBlackTree<K, V>::minimum(Node* node)
+{
+    while (node->m_left != nullptr) {
+        node = node->m_left;
+    }
+    return node;
+}
+
+template<typename K, typename V>
+inline typename RedBlackTree<K, V>::Node* RedBlackTree<K, V>::maximum(Node* node)
+{
+    while (node->m_right != nullptr) {
+        node = node->m_right;
+    }
+    return node;
+}
+
+template<typename K, typename V>
+inline void RedBlackTree<K, V>::rotate_left(Node* node)
+{
+    Node* pivot = node->m_right;
+    node->m_right = pivot->m_left;
+    if (pivot->m_left != nullptr) {
+        pivot->m_left->m_parent = node;
+    }
+
+    transplant(node, pivot);
+    pivot->m_left = node;
+    node->m_parent = pivot;
+}
+
+template<typename K, typename V>
+inline void RedBlackTree<K, V>::rotate_right(Node* node)
+{
+    Node* pivot = node->m_left;
+    node->m_left = pivot->m_right;
+    if (pivot->m_right != nullptr) {
+        pivot->m_right->m_parent = node;
+    }
+
+    transplant(node, pivot);
+    pivot->m_right = node;
+    node->m_parent = pivot;
+}
+
+template<typename K, typename V>
+inline void RedBlackTree<K, V>::transplant(Node* node, Node* replacement)
+{
+    if (node->m_parent == nullptr) {
+        m_root = replacement;
+    } else if (node == node->m_parent->m_left) {
+        node->m_parent->m_left = replacement;
+    } else {
+        node->m_parent->m_right = replacement;
+    }
+
+    if (replacement != nullptr) {
+        replacement->m_parent = node->m_parent;
+    }
+}
+
+template<typename K, typename V>
+inline void RedBlackTree<K, V>::insert_fixup(Node* node)
+{
+    while (is_red(node->m_parent)) {
+        Node* parent = node->m_parent;
+        Node* grandparent = parent->m_parent;
+
+        if (parent == grandparent->m_left) {
+            Node* uncle = grandparent->m_right;
+            if (is_red(uncle)) {
+                parent->m_is_red = false;
+                uncle->m_is_red = false;
+                grandparent->m_is_red = true;
+                node = grandparent;
+                continue;
+            }
+
+            if (node == parent->m_right) {
+                rotate_left(parent);
+                node = parent;
+                parent = node->m_parent;
+            }
+
+            parent->m_is_red = false;
+            grandparent->m_is_red = true;
+            rotate_right(grandparent);
+        } else {
+            Node* uncle = grandparent->m_left;
+            if (is_red(uncle)) {
+                parent->m_is_red = false;
+                uncle->m_is_red = false;
+                grandparent->m_is_red = true;
+                node = grandparent;
+                continue;
+            }
+
+            if (node == parent->m_left) {
+                rotate_right(parent);
+                node = parent;
+                parent = node->m_parent;
+            }
+
+            parent->m_is_red = false;
+            grandparent->m_is_red = true;
+            rotate_left(grandparent);
+        }
+    }
+
+    m_root->m_is_red = false;
+}
+
+template<typename K, typename V>
+inline void RedBlackTree<K, V>::remove_fixup(Node* node, Node* parent)
+{
+    while (node != m_root && !is_red(node)) {
+        if (node == parent->m_left) {
+            Node* sibling = parent->m_right;
+            if (is_red(sibling)) {
+                sibling->m_is_red = false;
+                parent->m_is_red = true;
+                rotate_left(parent);
+                sibling = parent->m_right;
+            }
+
+            if (!is_red(sibling->m_left) && !is_red(sibling->m_right)) {
+                sibling->m_is_red = true;
+                node = parent;
+                parent = node->m_parent;
+                continue;
+            }
+
+            if (!is_red(sibling->m_right)) {
+                sibling->m_left->m_is_red = false;
+                sibling->m_is_red = true;
+                rotate_right(sibling);
+                sibling = parent->m_right;
+            }
+
+            sibling->m_is_red = parent->m_is_red;
+            parent->m_is_red = false;
+            sibling->m_right->m_is_red = false;
+            rotate_left(parent);
+            node = m_root;
+        } else {
+            Node* sibling = parent->m_left;
+            if (is_red(sibling)) {
+                sibling->m_is_red = false;
+                parent->m_is_red = true;
+                rotate_right(parent);
+                sibling = parent->m_left;
+            }
+
+            if (!is_red(sibling->m_left) && !is_red(sibling->m_right)) {
+                sibling->m_is_red = true;
+                node = parent;
+                parent = node->m_parent;
+                continue;
+            }
+
+            if (!is_red(sibling->m_left)) {
+                sibling->m_right->m_is_red = false;
+                sibling->m_is_red = true;
+                rotate_left(sibling);
+                sibling = parent->m_left;
+            }
+
+            sibling->m_is_red = parent->m_is_red;
+            parent->m_is_red = false;
+            sibling->m_left->m_is_red = false;
+            rotate_right(parent);
+            node = m_root;
+        }
+    }
+
+    if (node != nullptr) {
+        node->m_is_red = false;
+    }
+}
+
+template<typename K, typename V>
+inline void RedBlackTree<K, V>::destroy(Node* node)
+{
+    if (node == nullptr) {
+        return;
+    }
+
+    destroy(node->m_left);
+    destroy(node->m_right);
+    delete node;
+}
+
+}
+
+using Universal::RedBlackTree;